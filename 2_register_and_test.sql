@@ -11,8 +11,112 @@ AS LANGUAGE 'C++'
 NAME 'ExactAvgFactory'
 LIBRARY exact_avg_lib;
 
+-- Create the INTEGER overload of exact_avg, so BIGINT/INTEGER columns are averaged exactly without a per-row cast to NUMERIC.
+CREATE OR REPLACE AGGREGATE FUNCTION exact_avg
+AS LANGUAGE 'C++'
+NAME 'ExactAvgIntFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the FLOAT overload of exact_avg, which sums FLOAT columns exactly and rounds the average once, independent of row order.
+CREATE OR REPLACE AGGREGATE FUNCTION exact_avg
+AS LANGUAGE 'C++'
+NAME 'ExactAvgFloatFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the INTERVAL, TIMESTAMP and TIMESTAMPTZ overloads of exact_avg, which average the underlying microseconds exactly and return the same type.
+CREATE OR REPLACE AGGREGATE FUNCTION exact_avg
+AS LANGUAGE 'C++'
+NAME 'ExactAvgIntervalFactory'
+LIBRARY exact_avg_lib;
+CREATE OR REPLACE AGGREGATE FUNCTION exact_avg
+AS LANGUAGE 'C++'
+NAME 'ExactAvgTimestampFactory'
+LIBRARY exact_avg_lib;
+CREATE OR REPLACE AGGREGATE FUNCTION exact_avg
+AS LANGUAGE 'C++'
+NAME 'ExactAvgTimestampTzFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the exact_sum aggregate function, the exact SUM that exact_avg accumulates, without the division.
+CREATE OR REPLACE AGGREGATE FUNCTION exact_sum
+AS LANGUAGE 'C++'
+NAME 'ExactSumFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the exact_var_pop, exact_var_samp and exact_stddev aggregate functions, which keep SUM(a) and SUM(a^2) exactly and round once.
+CREATE OR REPLACE AGGREGATE FUNCTION exact_var_pop
+AS LANGUAGE 'C++'
+NAME 'ExactVarPopFactory'
+LIBRARY exact_avg_lib;
+
+CREATE OR REPLACE AGGREGATE FUNCTION exact_var_samp
+AS LANGUAGE 'C++'
+NAME 'ExactVarSampFactory'
+LIBRARY exact_avg_lib;
+
+CREATE OR REPLACE AGGREGATE FUNCTION exact_stddev
+AS LANGUAGE 'C++'
+NAME 'ExactStddevFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the exact_covar_pop, exact_corr and exact_regr_slope aggregate functions over (y, x) pairs, which keep SUM(x), SUM(y), SUM(x*y) and the squares they need exactly in one pass.
+CREATE OR REPLACE AGGREGATE FUNCTION exact_covar_pop
+AS LANGUAGE 'C++'
+NAME 'ExactCovarPopFactory'
+LIBRARY exact_avg_lib;
+
+CREATE OR REPLACE AGGREGATE FUNCTION exact_corr
+AS LANGUAGE 'C++'
+NAME 'ExactCorrFactory'
+LIBRARY exact_avg_lib;
+
+CREATE OR REPLACE AGGREGATE FUNCTION exact_regr_slope
+AS LANGUAGE 'C++'
+NAME 'ExactRegrSlopeFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the exact_wavg aggregate function, SUM(v * w) / SUM(w) with the product summed exactly and one division.
+CREATE OR REPLACE AGGREGATE FUNCTION exact_wavg
+AS LANGUAGE 'C++'
+NAME 'ExactWavgFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the exact_moving_avg analytic function, an exact AVG over a sliding frame of window_rows rows.
+CREATE OR REPLACE ANALYTIC FUNCTION exact_moving_avg
+AS LANGUAGE 'C++'
+NAME 'ExactMovingAvgFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the exact_running_avg analytic function, an exact AVG over the cumulative frame (UNBOUNDED PRECEDING to CURRENT ROW).
+CREATE OR REPLACE ANALYTIC FUNCTION exact_running_avg
+AS LANGUAGE 'C++'
+NAME 'ExactRunningAvgFactory'
+LIBRARY exact_avg_lib;
+
+-- Create the exact_avg_multi transform function, exact_avg of every argument column in one pass over each partition.
+CREATE OR REPLACE TRANSFORM FUNCTION exact_avg_multi
+AS LANGUAGE 'C++'
+NAME 'ExactAvgMultiFactory'
+LIBRARY exact_avg_lib;
+
 -- Grant execute permission on the exact_avg aggregate function to all users, so everyone can call it without extra privileges.
 GRANT EXECUTE ON AGGREGATE FUNCTION exact_avg(NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_avg(INTEGER) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_avg(FLOAT) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_avg(INTERVAL) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_avg(TIMESTAMP) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_avg(TIMESTAMPTZ) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_sum(NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_var_pop(NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_var_samp(NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_stddev(NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_covar_pop(NUMERIC, NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_corr(NUMERIC, NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_regr_slope(NUMERIC, NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON AGGREGATE FUNCTION exact_wavg(NUMERIC, NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON ANALYTIC FUNCTION exact_moving_avg(NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON ANALYTIC FUNCTION exact_running_avg(NUMERIC) TO PUBLIC;
+GRANT EXECUTE ON TRANSFORM FUNCTION exact_avg_multi(ANY) TO PUBLIC;
 
 -- Drop any existing test table to ensure a clean environment before recreating it for this test.
 drop table if exists public.my_numeric_test cascade;
@@ -66,3 +170,146 @@ SELECT exact_avg(a) FROM public.my_numeric_test;
 --  3812992118856513317445415443007946568001321189163711731972459091786692913.9320000
 -- (1 row)
 
+
+\echo '##### Call exact_avg(a) with max_rows; declaring that no group has more than 1000 rows lets the intermediate SUM use 3 extra digits instead of 19, with the same result.'
+SELECT exact_avg(a USING PARAMETERS max_rows=1000) FROM public.my_numeric_test;
+--                                      exact_avg
+-- -----------------------------------------------------------------------------------
+--  3812992118856513317445415443007946568001321189163711731972459091786692913.9320000
+-- (1 row)
+
+\echo '##### Call exact_avg(a) with a max_rows below the real row count; it fails instead of risking an overflowing SUM.'
+SELECT exact_avg(a USING PARAMETERS max_rows=4) FROM public.my_numeric_test;
+-- ERROR:  ... exact_avg: a group has more than max_rows = 4 non-NULL rows; raise max_rows or omit it
+
+\echo '##### Call exact_avg(a) with compact_state; partial aggregates carry only the significant words of the SUM, with the same result.'
+SELECT exact_avg(a USING PARAMETERS compact_state=true) FROM public.my_numeric_test;
+--                                      exact_avg
+-- -----------------------------------------------------------------------------------
+--  3812992118856513317445415443007946568001321189163711731972459091786692913.9320000
+-- (1 row)
+
+\echo '##### Call exact_sum(a); the exact SUM behind exact_avg, as NUMERIC(94,2) for this NUMERIC(75,2) column.'
+SELECT exact_sum(a) FROM public.my_numeric_test;
+--                                   exact_sum
+-- ------------------------------------------------------------------------------
+--  19064960594282566587227077215039732840006605945818558659862295458933464569.66
+-- (1 row)
+
+\echo '##### Call the exact variance aggregates on values with a large mean and a small spread; VARIANCE works in FLOAT, where 1e20 + 1, 1e20 + 2 and 1e20 + 3 are all 1e20.'
+drop table if exists public.my_variance_test cascade;
+create table public.my_variance_test (a numeric(38,0));
+insert into public.my_variance_test values (100000000000000000001);
+insert into public.my_variance_test values (100000000000000000002);
+insert into public.my_variance_test values (100000000000000000003);
+commit;
+SELECT exact_var_pop(a), exact_var_samp(a), exact_stddev(a), variance(a) FROM public.my_variance_test;
+--  exact_var_pop | exact_var_samp | exact_stddev | variance
+-- ---------------+----------------+--------------+----------
+--         0.6667 |         1.0000 |       1.0000 |        0
+-- (1 row)
+
+\echo '##### Call the exact covariance, correlation and regression slope aggregates on (y, x) = (1e20 + 2k, 1e20 + k); in FLOAT every value is 1e20, so COVAR_POP sees no spread.'
+drop table if exists public.my_pair_test cascade;
+create table public.my_pair_test (y numeric(25,0), x numeric(25,0));
+insert into public.my_pair_test values (100000000000000000002, 100000000000000000001);
+insert into public.my_pair_test values (100000000000000000004, 100000000000000000002);
+insert into public.my_pair_test values (100000000000000000006, 100000000000000000003);
+commit;
+SELECT exact_covar_pop(y, x), exact_corr(y, x), exact_regr_slope(y, x), covar_pop(y, x) FROM public.my_pair_test;
+--  exact_covar_pop |           exact_corr            |         exact_regr_slope         | covar_pop
+-- -----------------+---------------------------------+----------------------------------+-----------
+--           1.3333 | 1.00000000000000000000000000000 | 2.000000000000000000000000000000 |         0
+-- (1 row)
+
+\echo '##### Call exact_wavg(price, qty); the row with a NULL price is skipped, weight and all: (10.00 * 1 + 20.00 * 3 + 33.33 * 2) / 6.'
+drop table if exists public.my_wavg_test cascade;
+create table public.my_wavg_test (price numeric(20,2), qty numeric(18,0));
+insert into public.my_wavg_test values (10.00, 1);
+insert into public.my_wavg_test values (20.00, 3);
+insert into public.my_wavg_test values (NULL, 5);
+insert into public.my_wavg_test values (33.33, 2);
+commit;
+SELECT exact_wavg(price, qty) FROM public.my_wavg_test;
+--  exact_wavg
+-- ------------
+--  22.7766667
+-- (1 row)
+
+\echo '##### Call exact_avg on an INTEGER column; the INTEGER overload sums in 128-bit integers and returns an exact NUMERIC(24,5), where AVG returns a FLOAT.'
+drop table if exists public.my_integer_test cascade;
+create table public.my_integer_test (a int);
+insert into public.my_integer_test values (9223372036854775807);
+insert into public.my_integer_test values (9223372036854775806);
+insert into public.my_integer_test values (1);
+commit;
+SELECT exact_avg(a), avg(a) FROM public.my_integer_test;
+--          exact_avg          |         avg
+-- ----------------------------+---------------------
+--  6148914691236517204.66667 | 6.14891469123652e+18
+-- (1 row)
+
+\echo '##### Call exact_avg on a FLOAT column; the FLOAT overload sums exactly and rounds once, where AVG loses the 1 to rounding when it is added next to 1e16 (AVG''s result depends on the order rows are added).'
+drop table if exists public.my_float_test cascade;
+create table public.my_float_test (a float);
+insert into public.my_float_test values (1e16);
+insert into public.my_float_test values (1);
+insert into public.my_float_test values (-1e16);
+commit;
+SELECT exact_avg(a), avg(a) FROM public.my_float_test;
+--      exact_avg     | avg
+-- -------------------+-----
+--  0.333333333333333 |   0
+-- (1 row)
+
+\echo '##### Call exact_avg on INTERVAL and TIMESTAMP columns; the result has the argument''s type, rounded to its precision.'
+drop table if exists public.my_time_test cascade;
+create table public.my_time_test (d interval day to second, t timestamp, t0 timestamp(0));
+insert into public.my_time_test values (interval '1 second', '2024-01-01 00:00:00', '2024-01-01 00:00:00');
+insert into public.my_time_test values (interval '1 second', '2024-01-01 00:00:01', '2024-01-01 00:00:01');
+insert into public.my_time_test values (interval '0', '2024-01-01 00:00:01', '2024-01-01 00:00:01');
+commit;
+SELECT exact_avg(d), exact_avg(t), exact_avg(t0) FROM public.my_time_test;
+--     exact_avg    |         exact_avg          |      exact_avg
+-- -----------------+----------------------------+---------------------
+--  00:00:00.666667 | 2024-01-01 00:00:00.666667 | 2024-01-01 00:00:01
+-- (1 row)
+
+\echo '##### Call exact_moving_avg over a 2-row frame of the NUMERIC(75,2) test table; each row averages itself and the row before it.'
+drop table if exists public.my_window_test cascade;
+create table public.my_window_test (t int, a numeric(75,2));
+insert into public.my_window_test values (1, 1.00);
+insert into public.my_window_test values (2, 2.00);
+insert into public.my_window_test values (3, 2.01);
+commit;
+SELECT t, exact_moving_avg(a USING PARAMETERS window_rows = 2) OVER (ORDER BY t) FROM public.my_window_test ORDER BY t;
+--  t | exact_moving_avg
+-- ---+------------------
+--  1 |       1.0000000
+--  2 |       1.5000000
+--  3 |       2.0050000
+-- (3 rows)
+
+\echo '##### Call exact_running_avg on the same table; each row averages itself and every row before it.'
+SELECT t, exact_running_avg(a) OVER (ORDER BY t) FROM public.my_window_test ORDER BY t;
+--  t | exact_running_avg
+-- ---+-------------------
+--  1 |        1.0000000
+--  2 |        1.5000000
+--  3 |        1.6700000
+-- (3 rows)
+
+\echo '##### Call exact_avg_multi on two columns at once; one output row per partition, NULL for a column with no non-NULL rows.'
+drop table if exists public.my_multi_test cascade;
+create table public.my_multi_test (g int, a numeric(20,2), b numeric(38,10));
+insert into public.my_multi_test values (1, 1.00, 0.1);
+insert into public.my_multi_test values (1, 2.00, NULL);
+insert into public.my_multi_test values (1, 2.01, 0.2);
+insert into public.my_multi_test values (2, NULL, 5);
+commit;
+SELECT g, exact_avg_multi(a, b) OVER (PARTITION BY g) FROM public.my_multi_test ORDER BY g;
+--  g |     a     |         b
+-- ---+-----------+-------------------
+--  1 | 1.6700000 | 0.150000000000000
+--  2 |           | 5.000000000000000
+-- (2 rows)
@@ -70,7 +70,7 @@ CROSS JOIN udx;
 \echo
 \echo '===== SUMMARY ====='
 \echo 'The built-in AVG() and SUM()/COUNT() become inaccurate for extremely large NUMERIC values.'
-\echo 'The exact_avg() UDX remains fully accurate by using a much wider internal NUMERIC(1024) for the SUM.'
+\echo 'The exact_avg() UDX remains fully accurate by using a much wider internal SUM (up to NUMERIC(1024), or binary beyond that).'
 \echo 'The final mathematical verification confirms that exact_avg() exactly matches the true average (diff = 0).'
 \echo '==================='
 
@@ -0,0 +1,84 @@
+#!/bin/bash
+# Sweep the exact_avg benchmark matrix by running 4_benchmark.sql once per scenario, then print the results table.
+#
+# Every scenario starts from the base values below and changes ONE dimension, for each precision in PRECISIONS,
+# so the sweep stays linear in the number of values instead of multiplying them all together.
+# Override any list or base value from the environment, e.g.:
+#   PRECISIONS="75 1000" ROWS_LIST="100000000" ./4_benchmark.sh
+#   VSQL="vsql -h node01 -U dbadmin -w secret" ./4_benchmark.sh
+
+VSQL=${VSQL:-vsql}
+RUN_ID=${RUN_ID:-$(date +%Y%m%d_%H%M%S)}
+
+# Values swept per dimension.
+PRECISIONS=${PRECISIONS:-"18 38 75 300 1000"}
+SCALES=${SCALES:-"0 2 half"}            # 'half' means p/2
+ROWS_LIST=${ROWS_LIST:-"1000000 10000000 100000000"}
+NULL_PCTS=${NULL_PCTS:-"0 5 50"}
+NEG_PCTS=${NEG_PCTS:-"0 50"}
+GROUPS_LIST=${GROUPS_LIST:-"1 1000 1000000"}
+
+# Base scenario that the other dimensions are varied around.
+BASE_S=${BASE_S:-2}
+BASE_ROWS=${BASE_ROWS:-10000000}
+BASE_NULL_PCT=${BASE_NULL_PCT:-5}
+BASE_NEG_PCT=${BASE_NEG_PCT:-50}
+BASE_GROUPS=${BASE_GROUPS:-1}
+
+# Run one scenario unless it has already been run in this sweep (the base scenario appears in every dimension).
+declare -A DONE
+run_scenario() {
+    local p=$1 s=$2 rows=$3 nulls=$4 negs=$5 groups=$6
+    local key="$p/$s/$rows/$nulls/$negs/$groups"
+    [ -n "${DONE[$key]}" ] && return
+    DONE[$key]=1
+    echo "=== p=$p s=$s rows=$rows null%=$nulls neg%=$negs groups=$groups"
+    $VSQL -v P=$p -v S=$s -v ROWS=$rows -v NULL_PCT=$nulls -v NEG_PCT=$negs -v GROUPS=$groups \
+          -v RUN_ID="'$RUN_ID'" -f 4_benchmark.sql || exit 1
+}
+
+for p in $PRECISIONS; do
+    for s in $SCALES; do
+        [ "$s" = half ] && s=$((p / 2))
+        run_scenario $p $s $BASE_ROWS $BASE_NULL_PCT $BASE_NEG_PCT $BASE_GROUPS
+    done
+    for rows in $ROWS_LIST; do
+        run_scenario $p $BASE_S $rows $BASE_NULL_PCT $BASE_NEG_PCT $BASE_GROUPS
+    done
+    for nulls in $NULL_PCTS; do
+        run_scenario $p $BASE_S $BASE_ROWS $nulls $BASE_NEG_PCT $BASE_GROUPS
+    done
+    for negs in $NEG_PCTS; do
+        run_scenario $p $BASE_S $BASE_ROWS $BASE_NULL_PCT $negs $BASE_GROUPS
+    done
+    for groups in $GROUPS_LIST; do
+        run_scenario $p $BASE_S $BASE_ROWS $BASE_NULL_PCT $BASE_NEG_PCT $groups
+    done
+done
+
+# Summarize the sweep: one line per scenario with each method's wall time, exact_avg's slowdown versus AVG and SUM/COUNT,
+# exact_var_samp's versus VARIANCE, and exact_avg's FLOAT overload's versus AVG over FLOAT.
+$VSQL -c "
+select p, s, row_count, null_pct, neg_pct, group_count,
+       max(case when method = 'exact_avg' then wall_ms end) as exact_avg_ms,
+       max(case when method = 'avg'       then wall_ms end) as avg_ms,
+       max(case when method = 'sum_count' then wall_ms end) as sum_count_ms,
+       max(case when method = 'exact_var_samp' then wall_ms end) as exact_var_samp_ms,
+       max(case when method = 'variance'  then wall_ms end) as variance_ms,
+       max(case when method = 'exact_avg_float' then wall_ms end) as exact_avg_float_ms,
+       max(case when method = 'avg_float' then wall_ms end) as avg_float_ms,
+       round(max(case when method = 'exact_avg' then wall_ms end)
+             / nullifzero(max(case when method = 'avg' then wall_ms end)), 2) as vs_avg,
+       round(max(case when method = 'exact_avg' then wall_ms end)
+             / nullifzero(max(case when method = 'sum_count' then wall_ms end)), 2) as vs_sum_count,
+       round(max(case when method = 'exact_var_samp' then wall_ms end)
+             / nullifzero(max(case when method = 'variance' then wall_ms end)), 2) as vs_variance,
+       round(max(case when method = 'exact_avg_float' then wall_ms end)
+             / nullifzero(max(case when method = 'avg_float' then wall_ms end)), 2) as vs_avg_float,
+       max(case when method = 'exact_avg' then memory_mb end) as exact_avg_mb
+from public.exact_avg_bench_results
+where run_id = '$RUN_ID'
+group by 1, 2, 3, 4, 5, 6
+order by 1, 2, 3, 4, 5, 6;"
+
+echo "Results are stored in public.exact_avg_bench_results with run_id '$RUN_ID'."
@@ -0,0 +1,187 @@
+---------------------------------------------------------------------------------------------
+-- Usage:  vsql -v P=75 -v S=2 -v ROWS=10000000 -v NULL_PCT=5 -v NEG_PCT=50 -v GROUPS=1 \
+--              -v RUN_ID="'manual'" -f 4_benchmark.sql
+--
+-- Runs ONE benchmark scenario; 4_benchmark.sh sweeps the full matrix by calling this file
+-- once per scenario. All variables are required:
+--   P, S      precision and scale of the benchmarked NUMERIC column
+--   ROWS      number of rows to generate
+--   NULL_PCT  percentage of NULL values (0-100)
+--   NEG_PCT   percentage of negative values among the non-NULL ones (0-100)
+--   GROUPS    GROUP BY cardinality (1 = a single group)
+--   RUN_ID    quoted label that ties the scenarios of one sweep together, e.g. "'2024-06-01'"
+---------------------------------------------------------------------------------------------
+
+-- Create the results table on first use; every scenario appends one row per method to it.
+create table if not exists public.exact_avg_bench_results (
+    run_id        varchar(64),
+    recorded_at   timestamptz default now(),
+    p             int,
+    s             int,
+    row_count     int,
+    null_pct      int,
+    neg_pct       int,
+    group_count   int,
+    method        varchar(32),
+    wall_ms       int,
+    memory_mb     float
+);
+
+-- Drop the data table of the previous scenario so the column can be recreated with this scenario's NUMERIC(P,S).
+drop table if exists public.exact_avg_bench_data cascade;
+
+-- Create the data table; g is the GROUP BY key, a is the benchmarked column and f is its FLOAT counterpart.
+create table public.exact_avg_bench_data (row_id int, g int, a numeric(:P,:S), f float)
+order by row_id
+segmented by hash(row_id) ALL NODES;
+
+-- Generate ROWS rows. Each value has P-S-1 integer digits (9 random ones followed by 7s) and S fractional digits,
+-- so the data uses nearly the whole declared precision; NULL_PCT/NEG_PCT control NULLs and the sign mix.
+-- f holds the same value as FLOAT, keeping at most 290 of the integer digits: beyond about 308 digits a::float
+-- would overflow, and the headroom keeps a 100M-row AVG(f) finite. f is NULL and negative on the same rows as a.
+INSERT /*+direct*/ INTO public.exact_avg_bench_data
+with myrows as (select
+row_number() over() as row_id
+from ( select 1 from ( select now() as se union all
+select now() + :ROWS - 1 as se) a timeseries ts as '1 day' over (order by se)) b),
+digits as (select row_id,
+    substr(lpad(randomint(1000000000)::varchar, 9, '0') || repeat('7', :P), 1, :P - :S - 1) as int_part,
+    case when :S > 0 then '.' || repeat('5', :S) else '' end as frac_part,
+    randomint(100) < :NULL_PCT as is_null,
+    randomint(100) < :NEG_PCT as is_neg
+from myrows),
+vals as (select row_id, is_null, is_neg,
+    (int_part || frac_part)::numeric(:P,:S) as v,
+    (substr(int_part, 1, 290) || frac_part)::float as d
+from digits)
+select row_id,
+       row_id % :GROUPS,
+       case when is_null then null when is_neg then -v else v end,
+       case when is_null then null when is_neg then -d else d end
+from vals;
+COMMIT;
+
+-- Each measured query wraps the aggregate in an outer COUNT/MAX so only one row reaches the client, even with
+-- millions of groups. Right after each one, its duration and the resource-pool memory it acquired are copied
+-- from v_monitor.query_requests (the session's last completed query) into the results table. The last pair times
+-- exact_avg's FLOAT overload against AVG's over the FLOAT column f.
+
+\timing on
+\echo
+\echo '##### exact_avg(a)'
+select count(*) as groups, max(x) as max_avg
+from (select g, exact_avg(a) as x from public.exact_avg_bench_data group by g) t;
+\timing off
+
+insert into public.exact_avg_bench_results
+    (run_id, p, s, row_count, null_pct, neg_pct, group_count, method, wall_ms, memory_mb)
+select :RUN_ID, :P, :S, :ROWS, :NULL_PCT, :NEG_PCT, :GROUPS, 'exact_avg', request_duration_ms, memory_acquired_mb
+from v_monitor.query_requests
+where session_id = (select session_id from v_monitor.current_session)
+  and request_type = 'QUERY' and not is_executing
+order by start_timestamp desc limit 1;
+
+\timing on
+\echo
+\echo '##### AVG(a)'
+select count(*) as groups, max(x) as max_avg
+from (select g, avg(a) as x from public.exact_avg_bench_data group by g) t;
+\timing off
+
+insert into public.exact_avg_bench_results
+    (run_id, p, s, row_count, null_pct, neg_pct, group_count, method, wall_ms, memory_mb)
+select :RUN_ID, :P, :S, :ROWS, :NULL_PCT, :NEG_PCT, :GROUPS, 'avg', request_duration_ms, memory_acquired_mb
+from v_monitor.query_requests
+where session_id = (select session_id from v_monitor.current_session)
+  and request_type = 'QUERY' and not is_executing
+order by start_timestamp desc limit 1;
+
+\timing on
+\echo
+\echo '##### SUM(a)/COUNT(a)'
+select count(*) as groups, max(x) as max_avg
+from (select g, sum(a)/count(a) as x from public.exact_avg_bench_data group by g) t;
+\timing off
+
+insert into public.exact_avg_bench_results
+    (run_id, p, s, row_count, null_pct, neg_pct, group_count, method, wall_ms, memory_mb)
+select :RUN_ID, :P, :S, :ROWS, :NULL_PCT, :NEG_PCT, :GROUPS, 'sum_count', request_duration_ms, memory_acquired_mb
+from v_monitor.query_requests
+where session_id = (select session_id from v_monitor.current_session)
+  and request_type = 'QUERY' and not is_executing
+order by start_timestamp desc limit 1;
+
+\timing on
+\echo
+\echo '##### exact_var_samp(a)'
+select count(*) as groups, max(x) as max_var
+from (select g, exact_var_samp(a) as x from public.exact_avg_bench_data group by g) t;
+\timing off
+
+insert into public.exact_avg_bench_results
+    (run_id, p, s, row_count, null_pct, neg_pct, group_count, method, wall_ms, memory_mb)
+select :RUN_ID, :P, :S, :ROWS, :NULL_PCT, :NEG_PCT, :GROUPS, 'exact_var_samp', request_duration_ms, memory_acquired_mb
+from v_monitor.query_requests
+where session_id = (select session_id from v_monitor.current_session)
+  and request_type = 'QUERY' and not is_executing
+order by start_timestamp desc limit 1;
+
+\timing on
+\echo
+\echo '##### VARIANCE(a)'
+select count(*) as groups, max(x) as max_var
+from (select g, variance(a) as x from public.exact_avg_bench_data group by g) t;
+\timing off
+
+insert into public.exact_avg_bench_results
+    (run_id, p, s, row_count, null_pct, neg_pct, group_count, method, wall_ms, memory_mb)
+select :RUN_ID, :P, :S, :ROWS, :NULL_PCT, :NEG_PCT, :GROUPS, 'variance', request_duration_ms, memory_acquired_mb
+from v_monitor.query_requests
+where session_id = (select session_id from v_monitor.current_session)
+  and request_type = 'QUERY' and not is_executing
+order by start_timestamp desc limit 1;
+
+\timing on
+\echo
+\echo '##### exact_avg(f)'
+select count(*) as groups, max(x) as max_avg
+from (select g, exact_avg(f) as x from public.exact_avg_bench_data group by g) t;
+\timing off
+
+insert into public.exact_avg_bench_results
+    (run_id, p, s, row_count, null_pct, neg_pct, group_count, method, wall_ms, memory_mb)
+select :RUN_ID, :P, :S, :ROWS, :NULL_PCT, :NEG_PCT, :GROUPS, 'exact_avg_float', request_duration_ms, memory_acquired_mb
+from v_monitor.query_requests
+where session_id = (select session_id from v_monitor.current_session)
+  and request_type = 'QUERY' and not is_executing
+order by start_timestamp desc limit 1;
+
+\timing on
+\echo
+\echo '##### AVG(f)'
+select count(*) as groups, max(x) as max_avg
+from (select g, avg(f) as x from public.exact_avg_bench_data group by g) t;
+\timing off
+
+insert into public.exact_avg_bench_results
+    (run_id, p, s, row_count, null_pct, neg_pct, group_count, method, wall_ms, memory_mb)
+select :RUN_ID, :P, :S, :ROWS, :NULL_PCT, :NEG_PCT, :GROUPS, 'avg_float', request_duration_ms, memory_acquired_mb
+from v_monitor.query_requests
+where session_id = (select session_id from v_monitor.current_session)
+  and request_type = 'QUERY' and not is_executing
+order by start_timestamp desc limit 1;
+COMMIT;
+
+\echo
+\echo '##### This scenario: every method time relative to AVG, SUM/COUNT, VARIANCE and AVG over FLOAT.'
+select method, wall_ms, memory_mb,
+       round(wall_ms / nullifzero(max(case when method = 'avg' then wall_ms end) over ()), 2) as vs_avg,
+       round(wall_ms / nullifzero(max(case when method = 'sum_count' then wall_ms end) over ()), 2) as vs_sum_count,
+       round(wall_ms / nullifzero(max(case when method = 'variance' then wall_ms end) over ()), 2) as vs_variance,
+       round(wall_ms / nullifzero(max(case when method = 'avg_float' then wall_ms end) over ()), 2) as vs_avg_float
+from public.exact_avg_bench_results
+where run_id = :RUN_ID and p = :P and s = :S and row_count = :ROWS
+  and null_pct = :NULL_PCT and neg_pct = :NEG_PCT and group_count = :GROUPS
+order by recorded_at desc, method
+limit 7;
+\echo '^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^'
@@ -0,0 +1,466 @@
+/*
+ * Standalone benchmark for the exact_avg UDx, built against the offline SDK
+ * stand-in in bench/sdk (see "make bench").
+ *
+ * For each input precision it drives the function the way the execution
+ * engine does:
+ *
+ *   - aggregate():      one group, all rows (SELECT exact_avg(a) FROM t)
+ *   - aggregateArrs():  many small groups (... GROUP BY k)
+ *   - combine():        merging per-node partials of those groups
+ *   - terminate():      finalizing every group, counting heap allocations
+ *
+ * and reports ns/row (or ns/group) and rows/sec. The single-group result and
+ * the first CHECKED_GROUPS GROUP BY groups' are checked against the SDK's own
+ * VNumeric::accumulate()/div(), so a kernel that is fast but wrong, or a
+ * run of rows routed to the wrong group, shows up as "FAIL" rather than a
+ * nice number; the time of the single group's plain accumulate() loop is
+ * reported as "ref ns/row".
+ * "state bytes" is the fixed size of an intermediate tuple; "partial bytes"
+ * is the average a GROUP BY partial actually takes once VARBINARY columns
+ * are counted at their length, i.e. what combine() would ship.
+ *
+ * Usage: exact_avg_bench [rows] [precision ...] [name=value ...]
+ *
+ * name=value pairs are passed as USING PARAMETERS, e.g. compact_state=true
+ * or max_rows=1000000000.
+ */
+#include "Vertica.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace Vertica;
+
+/*---------------------------------------------------------------------------
+ * Heap allocation counter
+ *-------------------------------------------------------------------------*/
+
+static bool countAllocations = false;
+static size_t allocationCount = 0;
+
+void *operator new(size_t size)
+{
+    if (countAllocations) {
+        allocationCount++;
+    }
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+/*---------------------------------------------------------------------------
+ * Helpers
+ *-------------------------------------------------------------------------*/
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedNs(Clock::time_point since)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - since).count();
+}
+
+static const int32 SCALE = 2;
+static const size_t BLOCK_ROWS = 4096;
+static const size_t GROUP_ROWS = 8;
+static const int32 PARTIALS = 4;
+static const int NULL_PERCENT = 5;
+static const int NEGATIVE_PERCENT = 50;
+
+// GROUP BY groups checked against the reference: the first 32 aggregateArrs()
+// calls' worth. The stand-in's VNumeric::div() is too slow to check them all.
+static const size_t CHECKED_GROUPS = 4096;
+
+// USING PARAMETERS given on the command line.
+static std::vector<std::pair<std::string, std::string> > parameters;
+
+/**
+ * A pool of input rows, cycled through to feed any number of rows without
+ * holding them all in memory. Values are uniformly random in bit length up
+ * to the declared precision, half of them negative, some NULL.
+ */
+struct InputPool
+{
+    InputPool(const SizedColumnTypes &inTypes, size_t rows, uint64 seed)
+        : rows(rows)
+    {
+        reader.bindLayout(inTypes);
+        rowSize = reader.getRowSize();
+        data.assign(rows * rowSize, 0);
+
+        const int32 p = inTypes.getColumnType(0).getNumericPrecision();
+        const int maxBits = static_cast<int>(std::floor(p * std::log2(10.0))) - 1;
+        std::mt19937_64 rng(seed);
+
+        for (size_t r = 0; r < rows; ++r) {
+            reader.bindBlock(&data[r * rowSize], 1);
+            VNumeric &v = reader.getNumericRef(0);
+            v.setZero();
+            if (static_cast<int>(rng() % 100) < NULL_PERCENT) {
+                v.setNull();
+                continue;
+            }
+            const int bits = 1 + static_cast<int>(rng() % maxBits);
+            for (int b = 0; b < bits; b += 64) {
+                uint64 w = rng();
+                if (bits - b < 64) {
+                    w &= (1ULL << (bits - b)) - 1;
+                }
+                v.words[v.nwds - 1 - b / 64] = w;
+            }
+            if (static_cast<int>(rng() % 100) < NEGATIVE_PERCENT) {
+                v.negate();
+            }
+        }
+    }
+
+    char *row(size_t r) { return &data[(r % rows) * rowSize]; }
+
+    size_t rows;
+    size_t rowSize;
+    BlockReader reader;
+    std::vector<char> data;
+};
+
+/** Contiguous storage for n intermediate tuples of one layout. */
+struct TupleArray
+{
+    TupleArray(const SizedColumnTypes &types, size_t n) : n(n)
+    {
+        view.bindLayout(types);
+        tupleSize = view.getRowSize();
+        data.assign(n * tupleSize, 0);
+    }
+
+    char *tuple(size_t i) { return &data[i * tupleSize]; }
+
+    IntermediateAggs &at(size_t i)
+    {
+        view.bindBase(tuple(i));
+        return view;
+    }
+
+    size_t n;
+    size_t tupleSize;
+    IntermediateAggs view;
+    std::vector<char> data;
+};
+
+struct Result
+{
+    double aggNsPerRow;
+    double refNsPerRow;
+    double groupByNsPerRow;
+    double combineNsPerPartial;
+    double terminateNsPerGroup;
+    size_t terminateAllocations;
+    size_t tupleBytes;
+    double partialBytes;
+    bool checked;
+};
+
+// Bytes an intermediate tuple carries, with VARBINARY columns at their
+// actual length (plus a 4-byte length) rather than their declared one.
+static size_t payloadBytes(IntermediateAggs &aggs, const SizedColumnTypes &types)
+{
+    size_t bytes = 0;
+    for (size_t c = 0; c < types.getColumnCount(); ++c) {
+        const VerticaType &t = types.getColumnType(c);
+        if (t.isVarbinary() || t.isLongVarbinary()) {
+            bytes += 4 + aggs.getStringRef(c).length();
+        } else {
+            bytes += t.getMockSlotSize();
+        }
+    }
+    return bytes;
+}
+
+// Whether each of the first groups' averages in outRows is that of its
+// PARTIALS * GROUP_ROWS consecutive pool rows, as aggregateArrs() was handed
+// them, computed with VNumeric::accumulate() and div() (NULL for no non-NULL
+// rows).
+static bool checkGroups(InputPool &pool, int32 p, const SizedColumnTypes &outTypes,
+                        std::vector<char> &outRows, size_t groups)
+{
+    const int32 sumTypmod = VNumeric::computeTypmod(p + 19, SCALE);
+    const int32 sumWords = VNumeric::getNumericWordCount(p + 19);
+    std::vector<uint64> refSum(sumWords), cntWords(sumWords);
+    VNumeric ref(&refSum[0], sumTypmod);
+    VNumeric cnt(&cntWords[0], sumTypmod);
+    const VerticaType &outType = outTypes.getColumnType(0);
+    std::vector<uint64> expWords(outType.getNumericWordCount(), 0);
+    VNumeric expected(&expWords[0], outType.getTypeMod());
+
+    BlockWriter writer;
+    writer.bindLayout(outTypes);
+    writer.bindBase(&outRows[0]);
+    BlockReader &reader = pool.reader;
+    const size_t groupRows = PARTIALS * GROUP_ROWS;
+    for (size_t g = 0; g < groups; ++g) {
+        ref.setZero();
+        vint refCnt = 0;
+        reader.bindBlock(pool.row(g * groupRows), groupRows);
+        do {
+            const VNumeric &v = reader.getNumericRef(0);
+            if (!v.isNull()) {
+                ref.accumulate(&v);
+                refCnt++;
+            }
+        } while (reader.next());
+
+        const VNumeric &got = writer.getNumericRef(0);
+        if (refCnt == 0) {
+            if (!got.isNull()) {
+                return false;
+            }
+        } else {
+            cnt.copy(refCnt);
+            expected.div(&ref, &cnt);
+            if (got.isNull() || !got.equal(&expected)) {
+                return false;
+            }
+        }
+        writer.next();
+    }
+    return true;
+}
+
+/*---------------------------------------------------------------------------
+ * One precision
+ *-------------------------------------------------------------------------*/
+
+static Result benchPrecision(AggregateFunctionFactory *factory, int32 p,
+                             size_t totalRows)
+{
+    Result res = Result();
+    ServerInterface srv;
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        const std::string &value = parameters[i].second;
+        if (value == "true" || value == "false") {
+            srv.getParamReader().setBool(parameters[i].first, value == "true");
+        } else {
+            srv.getParamReader().setInt(parameters[i].first,
+                                        strtoll(value.c_str(), 0, 10));
+        }
+    }
+
+    SizedColumnTypes inTypes, interTypes, outTypes;
+    inTypes.addNumeric(p, SCALE, "a");
+    factory->getIntermediateTypes(srv, inTypes, interTypes);
+    factory->getReturnType(srv, inTypes, outTypes);
+
+    AggregateFunction *fn = factory->createAggregateFunction(srv);
+    fn->setup(srv, inTypes);
+
+    // Up to 64K rows or 32 MB of input, whole blocks only.
+    const size_t rowBytes = inTypes.getColumnType(0).getMockSlotSize();
+    const size_t poolRows = std::max<size_t>(
+        1, std::min<size_t>(1 << 16, (32u << 20) / rowBytes) / BLOCK_ROWS) * BLOCK_ROWS;
+    InputPool pool(inTypes, poolRows, 42 + p);
+
+    // --- aggregate(): a single group over all rows -------------------------
+    TupleArray single(interTypes, 1);
+    fn->initAggregate(srv, single.at(0));
+    BlockReader &reader = pool.reader;
+
+    Clock::time_point t0 = Clock::now();
+    for (size_t done = 0; done < totalRows; done += BLOCK_ROWS) {
+        const size_t rows = std::min(BLOCK_ROWS, totalRows - done);
+        reader.bindBlock(pool.row(done), rows);
+        fn->aggregate(srv, reader, single.at(0));
+    }
+    res.aggNsPerRow = elapsedNs(t0) / static_cast<double>(totalRows);
+
+    // Reference: the same rows through VNumeric::accumulate() and div().
+    {
+        // NUMERIC(p + 19) holds any SUM; for p > 1005 that is wider than a
+        // real NUMERIC, which only the stand-in's VNumeric allows.
+        const int32 sumTypmod = VNumeric::computeTypmod(p + 19, SCALE);
+        const int32 sumWords = VNumeric::getNumericWordCount(p + 19);
+        std::vector<uint64> refSum(sumWords, 0);
+        VNumeric ref(&refSum[0], sumTypmod);
+        vint refCnt = 0;
+        t0 = Clock::now();
+        for (size_t done = 0; done < totalRows; done += BLOCK_ROWS) {
+            const size_t rows = std::min(BLOCK_ROWS, totalRows - done);
+            reader.bindBlock(pool.row(done), rows);
+            do {
+                const VNumeric &v = reader.getNumericRef(0);
+                if (!v.isNull()) {
+                    ref.accumulate(&v);
+                    refCnt++;
+                }
+            } while (reader.next());
+        }
+        res.refNsPerRow = elapsedNs(t0) / static_cast<double>(totalRows);
+
+        const VerticaType &outType = outTypes.getColumnType(0);
+        std::vector<uint64> expWords(outType.getNumericWordCount(), 0);
+        VNumeric expected(&expWords[0], outType.getTypeMod());
+        std::vector<uint64> cntWords(sumWords, 0);
+        VNumeric cnt(&cntWords[0], sumTypmod);
+        cnt.copy(refCnt);
+        expected.div(&ref, &cnt);
+
+        BlockWriter writer;
+        writer.bindLayout(outTypes);
+        std::vector<char> outRow(writer.getRowSize(), 0);
+        writer.bindBase(&outRow[0]);
+        fn->terminate(srv, writer, single.at(0));
+        res.checked = writer.getNumericRef(0).equal(&expected);
+    }
+
+    // --- aggregateArrs(): GROUP BY with small groups ------------------------
+    // As many groups as the rows allow, within 256 MB of partial tuples.
+    const size_t tupleBytes = single.tupleSize;
+    const size_t groups = std::max<size_t>(1, std::min<size_t>(
+        totalRows / GROUP_ROWS / PARTIALS, (256u << 20) / tupleBytes / PARTIALS));
+    TupleArray partials(interTypes, groups * PARTIALS);
+    for (size_t i = 0; i < partials.n; ++i) {
+        fn->initAggregate(srv, partials.at(i));
+    }
+    res.tupleBytes = partials.tupleSize;
+
+    // One call routes a block's worth of rows to BLOCK_ROWS / GROUP_ROWS
+    // groups, as the EE does for input sorted on the grouping key.
+    const int groupsPerCall = static_cast<int>(BLOCK_ROWS / GROUP_ROWS);
+    std::vector<void *> dstTuples(groupsPerCall);
+    std::vector<char *> args(groupsPerCall);
+    std::vector<vpos> counts(groupsPerCall, static_cast<vpos>(GROUP_ROWS));
+    std::vector<int> intOffsets;
+    IntermediateAggs groupAggs;
+    groupAggs.bindLayout(interTypes);
+
+    size_t groupRows = 0;
+    t0 = Clock::now();
+    for (size_t g = 0; g < partials.n; g += groupsPerCall) {
+        const int count = static_cast<int>(std::min<size_t>(groupsPerCall, partials.n - g));
+        for (int i = 0; i < count; ++i) {
+            dstTuples[i] = partials.tuple(g + i);
+            args[i] = pool.row((g + i) * GROUP_ROWS);
+        }
+        fn->aggregateArrs(srv, &dstTuples[0], 0, &args[0], sizeof(char *),
+                          &counts[0], sizeof(vpos), count, groupAggs,
+                          intOffsets, reader);
+        groupRows += static_cast<size_t>(count) * GROUP_ROWS;
+    }
+    res.groupByNsPerRow = elapsedNs(t0) / static_cast<double>(groupRows);
+
+    size_t shipped = 0;
+    for (size_t i = 0; i < partials.n; ++i) {
+        shipped += payloadBytes(partials.at(i), interTypes);
+    }
+    res.partialBytes = static_cast<double>(shipped) / static_cast<double>(partials.n);
+
+    // --- combine(): PARTIALS partials per group ----------------------------
+    TupleArray finals(interTypes, groups);
+    MultipleIntermediateAggs others;
+    others.bindLayout(interTypes);
+
+    t0 = Clock::now();
+    for (size_t g = 0; g < groups; ++g) {
+        fn->initAggregate(srv, finals.at(g));
+        others.bindBlock(partials.tuple(g * PARTIALS), PARTIALS);
+        fn->combine(srv, finals.at(g), others);
+    }
+    res.combineNsPerPartial =
+        elapsedNs(t0) / static_cast<double>(groups * PARTIALS);
+
+    // --- terminate(): every group, counting heap allocations ---------------
+    BlockWriter writer;
+    writer.bindLayout(outTypes);
+    std::vector<char> outRows(writer.getRowSize() * groups, 0);
+    writer.bindBase(&outRows[0]);
+
+    allocationCount = 0;
+    countAllocations = true;
+    t0 = Clock::now();
+    for (size_t g = 0; g < groups; ++g) {
+        fn->terminate(srv, writer, finals.at(g));
+        writer.next();
+    }
+    res.terminateNsPerGroup = elapsedNs(t0) / static_cast<double>(groups);
+    countAllocations = false;
+    res.terminateAllocations = allocationCount;
+
+    res.checked = checkGroups(pool, p, outTypes, outRows,
+                              std::min(groups, CHECKED_GROUPS)) && res.checked;
+
+    fn->destroy(srv, inTypes);
+    return res;
+}
+
+int main(int argc, char **argv)
+{
+    size_t rows = 10000000;
+    std::vector<int32> precisions;
+    if (argc > 1) {
+        rows = static_cast<size_t>(strtoull(argv[1], 0, 10));
+    }
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            precisions.push_back(atoi(argv[i]));
+        } else {
+            parameters.push_back(std::make_pair(arg.substr(0, eq), arg.substr(eq + 1)));
+        }
+    }
+    if (precisions.empty()) {
+        const int32 defaults[] = {18, 37, 75, 300, 1000};
+        precisions.assign(defaults, defaults + 5);
+    }
+
+    AggregateFunctionFactory *factory = dynamic_cast<AggregateFunctionFactory *>(
+        mockFactoryRegistry()["ExactAvgFactory"]);
+    if (!factory) {
+        fprintf(stderr, "ExactAvgFactory is not registered\n");
+        return 1;
+    }
+
+    printf("exact_avg benchmark: %zu rows per precision, NUMERIC(p,%d), "
+           "%d%% NULL, %d%% negative, GROUP BY groups of %zu rows, "
+           "%d partials per group\n\n",
+           rows, SCALE, NULL_PERCENT, NEGATIVE_PERCENT, GROUP_ROWS, PARTIALS);
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        printf("%s %s = %s", i ? "," : "USING PARAMETERS",
+               parameters[i].first.c_str(), parameters[i].second.c_str());
+    }
+    printf("%s", parameters.empty() ? "" : "\n\n");
+    printf("%9s %12s %12s %12s %14s %14s %16s %14s %11s %13s %6s\n",
+           "precision", "agg ns/row", "agg Mrows/s", "ref ns/row", "groupby ns/row",
+           "combine ns/pt", "terminate ns/grp", "term. allocs", "state bytes",
+           "partial bytes", "check");
+
+    bool allChecked = true;
+    for (size_t i = 0; i < precisions.size(); ++i) {
+        const int32 p = precisions[i];
+        try {
+            Result r = benchPrecision(factory, p, rows);
+            printf("%9d %12.2f %12.1f %12.2f %14.2f %14.2f %16.1f %14zu %11zu %13.1f %6s\n",
+                   p, r.aggNsPerRow, 1e3 / r.aggNsPerRow, r.refNsPerRow,
+                   r.groupByNsPerRow,
+                   r.combineNsPerPartial, r.terminateNsPerGroup,
+                   r.terminateAllocations, r.tupleBytes, r.partialBytes,
+                   r.checked ? "ok" : "FAIL");
+            allChecked = allChecked && r.checked;
+        } catch (std::exception &e) {
+            printf("%9d error: %s\n", p, e.what());
+            allChecked = false;
+        }
+    }
+    return allChecked ? 0 : 1;
+}
@@ -0,0 +1,1565 @@
+/*
+ * Correctness checks for the exact_avg UDx's functions, built against the
+ * offline SDK stand-in in bench/sdk and run by "make bench" (or "make
+ * check") before the benchmark.
+ *
+ * Each check drives a function the way the execution engine does, over
+ * seeded random inputs and a few hand-picked edge cases, and compares the
+ * results with a reference computed independently of the UDx's kernels:
+ *
+ *   - aggregates: one group's rows are dealt to PARTIALS partial states,
+ *     fed in blocks of varying length (some as GROUP BY runs through
+ *     aggregateArrs()), merged with one multi-partial combine() and
+ *     terminated.
+ *
+ *   - analytics: several partitions of different lengths go through one
+ *     instance, set up once, so that later partitions reuse the buffers the
+ *     earlier ones grew; every output row is checked.
+ *
+ * A result may also be an error where the exact answer does not fit the
+ * result type; such an error only passes if the reference agrees.
+ *
+ * Usage: exact_avg_check [seed]
+ */
+#include "Vertica.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Vertica;
+
+/*---------------------------------------------------------------------------
+ * Helpers
+ *-------------------------------------------------------------------------*/
+
+static const int32 PARTIALS = 4;
+static const size_t MAX_BLOCK_ROWS = 4096;
+static const size_t SHORT_BLOCK_ROWS = 16;
+
+// Failures printed in full per check; the rest are only counted.
+static const int MAX_REPORTED = 10;
+
+static std::mt19937_64 rng;
+
+// A uniformly random integer in [lo, hi].
+static int64 randomIn(int64 lo, int64 hi)
+{
+    return lo + static_cast<int64>(rng() % static_cast<uint64>(hi - lo + 1));
+}
+
+/** Pass/fail tally of one function's cases. */
+struct Check
+{
+    explicit Check(const char *name) : name(name), cases(0), failures(0) {}
+
+    void expect(bool ok, const std::string &detail)
+    {
+        cases++;
+        if (!ok && ++failures <= MAX_REPORTED) {
+            printf("FAIL %s: %s\n", name, detail.c_str());
+        }
+    }
+
+    bool done() const
+    {
+        printf("%-18s %6d cases  %s\n", name, cases, failures ? "FAIL" : "ok");
+        return failures == 0;
+    }
+
+    const char *name;
+    int cases;
+    int failures;
+};
+
+/** Rows of one input layout, written up front and read back in blocks. */
+struct Table
+{
+    explicit Table(const SizedColumnTypes &types) : types(types), rows(0)
+    {
+        reader.bindLayout(types);
+        rowSize = reader.getRowSize();
+    }
+
+    // Appends a zeroed row and returns the reader bound to it alone.
+    BlockReader &append()
+    {
+        data.resize(data.size() + rowSize, 0);
+        reader.bindBlock(row(rows++), 1);
+        return reader;
+    }
+
+    char *row(size_t r) { return &data[r * rowSize]; }
+
+    SizedColumnTypes types;
+    size_t rows;
+    size_t rowSize;
+    BlockReader reader;
+    std::vector<char> data;
+};
+
+/** Contiguous storage for n intermediate tuples of one layout. */
+struct TupleArray
+{
+    TupleArray(const SizedColumnTypes &types, size_t n) : n(n)
+    {
+        view.bindLayout(types);
+        tupleSize = view.getRowSize();
+        data.assign(n * tupleSize, 0);
+    }
+
+    char *tuple(size_t i) { return &data[i * tupleSize]; }
+
+    IntermediateAggs &at(size_t i)
+    {
+        view.bindBase(tuple(i));
+        return view;
+    }
+
+    size_t n;
+    size_t tupleSize;
+    IntermediateAggs view;
+    std::vector<char> data;
+};
+
+// Sets v to the largest magnitude of its precision, 10^p - 1.
+static void largestNumeric(VNumeric &v)
+{
+    // 1 at scale p is 10^p raw, one digit too many for v; adding a raw -1
+    // and copying back at the same scale leaves v's raw value 10^p - 1.
+    const int32 p = v.getPrecision();
+    std::vector<uint64> words(VNumeric::getNumericWordCount(p + 1), 0);
+    VNumeric power(&words[0], p + 1, p);
+    power.copy(static_cast<vint>(1));
+    uint64 minusOne = ~0ULL;
+    VNumeric one(&minusOne, 18, 0);
+    power.accumulate(&one);
+    VNumeric(v.words, p, p).copy(&power);
+}
+
+// Sets v to a random value of its precision: uniform in bit length or, one
+// time in eight, the largest magnitude; negative one time in two.
+static void randomNumeric(VNumeric &v)
+{
+    v.setZero();
+    if (rng() % 8 == 0) {
+        largestNumeric(v);
+    } else {
+        const int32 p = v.getPrecision();
+        const int maxBits = static_cast<int>(std::floor(p * std::log2(10.0))) - 1;
+        const int bits = 1 + static_cast<int>(rng() % maxBits);
+        for (int b = 0; b < bits; b += 64) {
+            uint64 w = rng();
+            if (bits - b < 64) {
+                w &= (1ULL << (bits - b)) - 1;
+            }
+            v.words[v.nwds - 1 - b / 64] = w;
+        }
+    }
+    if (rng() % 2) {
+        v.negate();
+    }
+}
+
+/**
+ * Exact SUM and count of a set of NUMERIC(p, s) values, kept with the
+ * SDK's own VNumeric arithmetic, from which averages are rounded the way
+ * exact_avg rounds them.
+ */
+struct ReferenceSum
+{
+    ReferenceSum(int32 p, int32 s)
+        : words(VNumeric::getNumericWordCount(p + 20), 0),
+          sum(&words[0], p + 20, s), count(0)
+    {
+    }
+
+    void add(const VNumeric &v)
+    {
+        if (!v.isNull()) {
+            sum.accumulate(&v);
+            count++;
+        }
+    }
+
+    void remove(const VNumeric &v)
+    {
+        if (!v.isNull()) {
+            sum.sub(&sum, &v);
+            count--;
+        }
+    }
+
+    // Sets out to SUM / count, rounded half away from zero at out's scale,
+    // or NULL when there are no values.
+    void average(VNumeric &out) const
+    {
+        if (count == 0) {
+            out.setNull();
+            return;
+        }
+        uint64 countWords[2] = { 0, 0 };
+        VNumeric countValue(countWords, 20, 0);
+        countValue.copy(count);
+        out.div(&sum, &countValue);
+    }
+
+    std::vector<uint64> words;
+    VNumeric sum;
+    vint count;
+};
+
+// Digits of the reference arithmetic on products of SUMs: enough for
+// SUM(a)^2 and n SUM(a^2) of NUMERIC(1024) inputs, and for exact_corr's
+// (n SUM(x y) - SUM(x) SUM(y))^2 against a squared NUMERIC(1029) result
+// times the product of two such spreads.
+static const int32 REF_PRECISION = 10000;
+
+/** A VNumeric of REF_PRECISION digits at a given scale, in its own words. */
+struct RefNumeric
+{
+    explicit RefNumeric(int32 scale)
+        : words(VNumeric::getNumericWordCount(REF_PRECISION), 0),
+          value(&words[0], REF_PRECISION, scale)
+    {
+    }
+
+    std::vector<uint64> words;
+    VNumeric value;
+};
+
+// Whether error was reported under name, at the top level and, if it
+// wraps another, inside the brackets too.
+static bool reportedAs(const std::string &error, const std::string &name)
+{
+    const size_t inner = error.find('[');
+    return error.compare(0, name.size() + 2, name + ": ") == 0 &&
+           (inner == std::string::npos ||
+            error.compare(inner + 1, name.size() + 2, name + ": ") == 0);
+}
+
+// Checks that factory's argument and parameter checks report under name:
+// one argument too many, VARCHAR arguments and max_rows = 0 must each fail
+// with an error that starts with name. argCount is the number of NUMERIC
+// arguments a valid call takes.
+static void checkTypeErrors(Check &check, AggregateFunctionFactory *factory,
+                            const std::string &name, size_t argCount)
+{
+    for (int bad = 0; bad < 3; ++bad) {
+        ServerInterface srv;
+        SizedColumnTypes inTypes, types;
+        for (size_t i = 0; i < argCount + (bad == 0 ? 1 : 0); ++i) {
+            if (bad == 2) {
+                inTypes.addVarchar(10);
+            } else {
+                inTypes.addNumeric(18, 2);
+            }
+        }
+        if (bad == 1) {
+            srv.getParamReader().setInt("max_rows", 0);
+        }
+        std::string error;
+        try {
+            factory->getIntermediateTypes(srv, inTypes, types);
+        } catch (std::exception &e) {
+            error = e.what();
+        }
+        check.expect(error.compare(0, name.size() + 1, name + " ") == 0 ||
+                         error.compare(0, name.size() + 2, name + ": ") == 0,
+                     "getIntermediateTypes() error \"" + error + "\"");
+    }
+}
+
+// Whether got and expected are the same NUMERIC value or both NULL; adds
+// both to detail when they are not.
+static bool sameNumeric(const VNumeric &got, const VNumeric &expected,
+                        std::string &detail)
+{
+    const bool same = got.isNull() || expected.isNull()
+        ? got.isNull() && expected.isNull()
+        : got.equal(&expected);
+    if (!same) {
+        detail += ", expected " + expected.toString() + ", got " + got.toString();
+    }
+    return same;
+}
+
+// What appendNumerics() fills the non-NULL rows with.
+enum ValueMix
+{
+    RANDOM_VALUES,   // randomNumeric()
+    LARGEST_VALUES,  // 10^p - 1
+    EXTREME_VALUES,  // 10^p - 1 or -(10^p - 1)
+    CLUSTERED_VALUES // 10^p - 1 less 0 to 999 units in the last place
+};
+
+// Sets v to a non-NULL value of the given mix.
+static void fillNumeric(VNumeric &v, ValueMix mix)
+{
+    if (mix == RANDOM_VALUES) {
+        randomNumeric(v);
+        return;
+    }
+    largestNumeric(v);
+    if (mix == EXTREME_VALUES && rng() % 2) {
+        v.negate();
+    } else if (mix == CLUSTERED_VALUES) {
+        uint64 below = 0 - static_cast<uint64>(randomIn(0, 999));
+        VNumeric offset(&below, 18, v.getScale());
+        v.accumulate(&offset);
+    }
+}
+
+// Appends rows NUMERIC values of the given mix to table's first column.
+// NULL runs of up to maxNullRun rows start at nullPercent percent of the
+// rows.
+static void appendNumerics(Table &table, size_t rows, int nullPercent,
+                           vint maxNullRun, ValueMix mix)
+{
+    vint nullsLeft = 0;
+    for (size_t r = 0; r < rows; ++r) {
+        VNumeric &v = table.append().getNumericRef(0);
+        if (nullsLeft == 0 && static_cast<int>(rng() % 100) < nullPercent) {
+            nullsLeft = randomIn(1, maxNullRun);
+        }
+        if (nullsLeft > 0) {
+            v.setNull();
+            nullsLeft--;
+        } else {
+            fillNumeric(v, mix);
+        }
+    }
+}
+
+// Feeds rows [first, last) of table to fn for the tuple in aggs, in blocks
+// of random length: half of them shorter than SHORT_BLOCK_ROWS, and one in
+// four as a single-group aggregateArrs() call.
+static void feedRows(ServerInterface &srv, AggregateFunction *fn, Table &table,
+                     size_t first, size_t last, IntermediateAggs &aggs,
+                     char *tuple)
+{
+    IntermediateAggs groupAggs;
+    groupAggs.bindLayout(aggs.getTypeMetaData());
+    std::vector<int> intOffsets;
+    BlockReader &reader = table.reader;
+
+    while (first < last) {
+        size_t rows = rng() % 2
+            ? static_cast<size_t>(randomIn(1, SHORT_BLOCK_ROWS - 1))
+            : static_cast<size_t>(randomIn(SHORT_BLOCK_ROWS, MAX_BLOCK_ROWS));
+        rows = std::min(rows, last - first);
+        if (rng() % 4 == 0) {
+            void *dstTuple = tuple;
+            char *arg = table.row(first);
+            const vpos count = static_cast<vpos>(rows);
+            fn->aggregateArrs(srv, &dstTuple, 0, &arg, sizeof(char *), &count,
+                              sizeof(vpos), 1, groupAggs, intOffsets, reader);
+        } else {
+            reader.bindBlock(table.row(first), rows);
+            fn->aggregate(srv, reader, aggs);
+        }
+        first += rows;
+    }
+}
+
+/*
+ * Runs all of table's rows through a new instance of factory as one group:
+ * the rows are dealt to PARTIALS partial states in contiguous runs (some
+ * possibly empty), each fed by feedRows(), and the partials are merged with
+ * a single multi-partial combine() before terminate() writes outRow.
+ * Returns false, with the error text in error, if the function reported
+ * one.
+ */
+static bool runAggregate(ServerInterface &srv, AggregateFunctionFactory *factory,
+                         Table &table, const SizedColumnTypes &outTypes,
+                         std::vector<char> &outRow, std::string &error)
+{
+    try {
+        SizedColumnTypes interTypes;
+        factory->getIntermediateTypes(srv, table.types, interTypes);
+        AggregateFunction *fn = factory->createAggregateFunction(srv);
+        fn->setup(srv, table.types);
+
+        TupleArray partials(interTypes, PARTIALS);
+        std::vector<size_t> cuts(1, 0);
+        for (int32 k = 1; k < PARTIALS; ++k) {
+            cuts.push_back(table.rows ? rng() % (table.rows + 1) : 0);
+        }
+        cuts.push_back(table.rows);
+        std::sort(cuts.begin(), cuts.end());
+        for (int32 k = 0; k < PARTIALS; ++k) {
+            fn->initAggregate(srv, partials.at(k));
+            feedRows(srv, fn, table, cuts[k], cuts[k + 1], partials.at(k),
+                     partials.tuple(k));
+        }
+
+        MultipleIntermediateAggs others;
+        others.bindLayout(interTypes);
+        others.bindBlock(partials.tuple(1), PARTIALS - 1);
+        fn->combine(srv, partials.at(0), others);
+
+        BlockWriter writer;
+        writer.bindLayout(outTypes);
+        outRow.assign(writer.getRowSize(), 0);
+        writer.bindBase(&outRow[0]);
+        fn->terminate(srv, writer, partials.at(0));
+        fn->destroy(srv, table.types);
+        return true;
+    } catch (std::exception &e) {
+        error = e.what();
+        return false;
+    }
+}
+
+/*
+ * Runs rows [first, last) of table through fn as one partition, with room
+ * for outRows output rows in out (laid out as the function's output).
+ * Returns false, with the error text in error, if the function reported
+ * one.
+ */
+template <class Reader, class Writer, class Function>
+static bool runPartition(ServerInterface &srv, Function *fn, Table &table,
+                         size_t first, size_t last, Table &out, size_t outRows,
+                         std::string &error)
+{
+    Reader reader;
+    reader.bindLayout(table.types);
+    reader.bindBlock(table.row(first), last - first);
+    out.data.assign(outRows * out.rowSize, 0);
+    out.rows = outRows;
+    Writer writer;
+    writer.bindLayout(out.types);
+    writer.bindBase(out.row(0));
+    try {
+        fn->processPartition(srv, reader, writer);
+        return true;
+    } catch (std::exception &e) {
+        error = e.what();
+        return false;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ * exact_avg(FLOAT)
+ *-------------------------------------------------------------------------*/
+
+static const vfloat TINY = 4.9406564584124654e-324; // 2^-1074
+static const vfloat NOT_A_NUMBER = std::numeric_limits<vfloat>::quiet_NaN();
+static const vfloat INF = std::numeric_limits<vfloat>::infinity();
+
+// Runs values (vfloat_null for NULL) through exact_avg(FLOAT) and checks
+// the result against expected (vfloat_null for NULL, NaN for NaN).
+static void checkFloatCase(Check &check, AggregateFunctionFactory *factory,
+                           const std::vector<vfloat> &values, vfloat expected)
+{
+    ServerInterface srv;
+    SizedColumnTypes inTypes, outTypes;
+    inTypes.addFloat("a");
+    factory->getReturnType(srv, inTypes, outTypes);
+
+    Table table(inTypes);
+    for (size_t i = 0; i < values.size(); ++i) {
+        table.append().getFloatRef(0) = values[i];
+    }
+
+    std::vector<char> outRow;
+    std::string error;
+    char detail[128];
+    snprintf(detail, sizeof(detail), "%zu rows, expected %a", values.size(),
+             expected);
+    if (!runAggregate(srv, factory, table, outTypes, outRow, error)) {
+        check.expect(false, std::string(detail) + ", got error " + error);
+        return;
+    }
+    BlockWriter writer;
+    writer.bindLayout(outTypes);
+    writer.bindBase(&outRow[0]);
+    const vfloat got = writer.getFloatRef(0);
+    bool ok;
+    if (vfloatIsNull(expected)) {
+        ok = vfloatIsNull(got);
+    } else if (std::isnan(expected)) {
+        ok = std::isnan(got) && !vfloatIsNull(got);
+    } else {
+        ok = !vfloatIsNull(got) && got == expected;
+    }
+    snprintf(detail + strlen(detail), sizeof(detail) - strlen(detail),
+             ", got %a", got);
+    check.expect(ok, detail);
+}
+
+// sum / n rounded to the nearest integer, ties to even.
+static int64 roundHalfEven(int64 sum, int64 n)
+{
+    const bool neg = sum < 0;
+    const int64 a = neg ? -sum : sum;
+    int64 q = a / n;
+    const int64 r2 = 2 * (a % n);
+    if (r2 > n || (r2 == n && (q & 1))) {
+        q++;
+    }
+    return neg ? -q : q;
+}
+
+static bool checkFloatAverage()
+{
+    Check check("exact_avg(FLOAT)");
+    AggregateFunctionFactory *factory = dynamic_cast<AggregateFunctionFactory *>(
+        mockFactoryRegistry()["ExactAvgFloatFactory"]);
+
+    // Subnormal averages, down to those below half of 2^-1074 that keep no
+    // significant bits at all, and the special values.
+    struct FixedCase
+    {
+        vfloat values[4];
+        int count;
+        vfloat expected;
+    };
+    const FixedCase fixed[] = {
+        { {TINY, 0, 0}, 3, 0 },
+        { {-TINY, 0, 0}, 3, 0 },
+        { {TINY, TINY, 0}, 3, TINY },
+        { {TINY, 0}, 2, 0 },
+        { {3 * TINY, 0}, 2, 2 * TINY },
+        { {TINY, 0, 0, 0}, 4, 0 },
+        { {std::ldexp(1.0, -1022), 0}, 2, std::ldexp(1.0, -1023) },
+        { {std::numeric_limits<vfloat>::max(), std::numeric_limits<vfloat>::max()},
+          2, std::numeric_limits<vfloat>::max() },
+        { {1e16, 1, -1e16}, 3, 1.0 / 3.0 },
+        { {INF, 1}, 2, INF },
+        { {-INF, INF}, 2, NOT_A_NUMBER },
+        { {NOT_A_NUMBER, 1}, 2, NOT_A_NUMBER },
+        { {vfloat_null, vfloat_null}, 2, vfloat_null },
+        { {0}, 0, vfloat_null },
+    };
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); ++i) {
+        std::vector<vfloat> values(fixed[i].values, fixed[i].values + fixed[i].count);
+        checkFloatCase(check, factory, values, fixed[i].expected);
+    }
+
+    // Random integers times a common power of two: the exact sum is an
+    // int64, so the expected average is one correctly rounded division,
+    // ldexp()-ed into the normal range or, at 2^-1074, rounded by hand.
+    for (int round = 0; round < 200; ++round) {
+        const bool subnormal = round % 2 == 1;
+        const int64 bound = subnormal ? (1LL << 20) : (1LL << 40);
+        const int exponent = subnormal ? -1074 : static_cast<int>(randomIn(-1000, 900));
+        const int64 rows = randomIn(1, round < 100 ? 20 : 3000);
+        std::vector<vfloat> values;
+        int64 sum = 0;
+        int64 count = 0;
+        for (int64 r = 0; r < rows; ++r) {
+            if (rng() % 20 == 0) {
+                values.push_back(vfloat_null);
+                continue;
+            }
+            const int64 k = randomIn(-bound, bound);
+            values.push_back(std::ldexp(static_cast<vfloat>(k), exponent));
+            sum += k;
+            count++;
+        }
+        const vfloat expected = count == 0 ? vfloat_null
+            : subnormal ? std::ldexp(static_cast<vfloat>(roundHalfEven(sum, count)), -1074)
+            : std::ldexp(static_cast<vfloat>(sum) / static_cast<vfloat>(count), exponent);
+        checkFloatCase(check, factory, values, expected);
+    }
+    return check.done();
+}
+
+/*---------------------------------------------------------------------------
+ * exact_moving_avg
+ *-------------------------------------------------------------------------*/
+
+static bool checkMovingAverage()
+{
+    Check check("exact_moving_avg");
+    AnalyticFunctionFactory *factory = dynamic_cast<AnalyticFunctionFactory *>(
+        mockFactoryRegistry()["ExactMovingAvgFactory"]);
+
+    struct MovingCase
+    {
+        int32 p;
+        int32 s;
+        vint windowRows;
+        int nullPercent;
+        ValueMix mix;
+        size_t partitionRows[3];
+    };
+    const MovingCase cases[] = {
+        // Windows longer than the initial 1024-slot ring: it grows while
+        // the first partition fills the frame, and the later ones reuse it.
+        { 18, 2, 3000, 5, RANDOM_VALUES, {5000, 1200, 7000} },
+        { 38, 0, 1025, 5, LARGEST_VALUES, {4000, 1, 2000} },
+        { 300, 150, 1024, 5, RANDOM_VALUES, {2500, 1024, 1023} },
+        // A window longer than every partition: the ring only grows with
+        // the partition.
+        { 38, 10, 1000000, 5, RANDOM_VALUES, {2100, 10, 1} },
+        // Short windows that wrap many times, over NULL runs as long as the
+        // window and longer.
+        { 18, 0, 1, 30, RANDOM_VALUES, {500, 3, 100} },
+        { 75, 30, 7, 40, RANDOM_VALUES, {3000, 5, 3000} },
+        { 1000, 500, 40, 20, RANDOM_VALUES, {1500, 41, 39} },
+        { 1024, 0, 100, 10, LARGEST_VALUES, {600, 250, 1} },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        const MovingCase &mc = cases[c];
+        ServerInterface srv;
+        srv.getParamReader().setInt("window_rows", mc.windowRows);
+        SizedColumnTypes inTypes, outTypes;
+        inTypes.addNumeric(mc.p, mc.s, "a");
+        factory->getReturnType(srv, inTypes, outTypes);
+
+        Table table(inTypes);
+        for (int k = 0; k < 3; ++k) {
+            appendNumerics(table, mc.partitionRows[k], mc.nullPercent,
+                           std::min<vint>(mc.windowRows + 1, 64), mc.mix);
+        }
+        Table out(outTypes);
+        std::vector<uint64> expWords(outTypes.getColumnType(0).getNumericWordCount());
+        VNumeric expected(&expWords[0], outTypes.getColumnType(0).getTypeMod());
+
+        AnalyticFunction *fn = factory->createAnalyticFunction(srv);
+        fn->setup(srv, inTypes);
+        size_t first = 0;
+        for (int k = 0; k < 3; ++k) {
+            const size_t rows = mc.partitionRows[k];
+            char detail[128];
+            snprintf(detail, sizeof(detail),
+                     "NUMERIC(%d,%d), window_rows = %lld, partition %d",
+                     mc.p, mc.s, static_cast<long long>(mc.windowRows), k + 1);
+            std::string error;
+            if (!runPartition<AnalyticPartitionReader, AnalyticPartitionWriter>(
+                    srv, fn, table, first, first + rows, out, rows, error)) {
+                check.expect(false, std::string(detail) + ": error " + error);
+                first += rows;
+                continue;
+            }
+
+            // The frame is rows [r - window_rows + 1, r], kept as a running
+            // SUM that the row leaving the frame is subtracted from.
+            ReferenceSum frame(mc.p, mc.s);
+            bool ok = true;
+            std::string failure = detail;
+            for (size_t r = 0; r < rows; ++r) {
+                table.reader.bindBlock(table.row(first + r), 1);
+                frame.add(table.reader.getNumericRef(0));
+                if (static_cast<vint>(r) >= mc.windowRows) {
+                    table.reader.bindBlock(table.row(first + r - mc.windowRows), 1);
+                    frame.remove(table.reader.getNumericRef(0));
+                }
+                frame.average(expected);
+                out.reader.bindBlock(out.row(r), 1);
+                if (ok && !sameNumeric(out.reader.getNumericRef(0), expected, failure)) {
+                    ok = false;
+                    char at[32];
+                    snprintf(at, sizeof(at), " at row %zu", r + 1);
+                    failure += at;
+                }
+            }
+            check.expect(ok, failure);
+            first += rows;
+        }
+        fn->destroy(srv, inTypes);
+    }
+    return check.done();
+}
+
+/*---------------------------------------------------------------------------
+ * exact_running_avg
+ *-------------------------------------------------------------------------*/
+
+static bool checkRunningAverage()
+{
+    Check check("exact_running_avg");
+    AnalyticFunctionFactory *factory = dynamic_cast<AnalyticFunctionFactory *>(
+        mockFactoryRegistry()["ExactRunningAvgFactory"]);
+
+    struct RunningCase
+    {
+        int32 p;
+        int32 s;
+        vint maxRows; // 0 for no max_rows parameter
+        int nullPercent;
+        ValueMix mix;
+        size_t partitionRows[3];
+    };
+    const RunningCase cases[] = {
+        { 18, 2, 0, 5, RANDOM_VALUES, {5000, 1, 3000} },
+        { 38, 38, 0, 30, RANDOM_VALUES, {2000, 40, 700} },
+        { 300, 0, 0, 10, LARGEST_VALUES, {3000, 2, 500} },
+        { 1024, 512, 0, 20, RANDOM_VALUES, {800, 300, 1} },
+        // A max_rows SUM just wide enough; a partition with more non-NULL
+        // rows than max_rows must fail, and the next one still work.
+        { 18, 0, 1000, 5, LARGEST_VALUES, {1050, 2000, 1000} },
+        { 75, 5, 10, 50, RANDOM_VALUES, {30, 200, 12} },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        const RunningCase &rc = cases[c];
+        ServerInterface srv;
+        if (rc.maxRows > 0) {
+            srv.getParamReader().setInt("max_rows", rc.maxRows);
+        }
+        SizedColumnTypes inTypes, outTypes;
+        inTypes.addNumeric(rc.p, rc.s, "a");
+        factory->getReturnType(srv, inTypes, outTypes);
+
+        Table table(inTypes);
+        for (int k = 0; k < 3; ++k) {
+            appendNumerics(table, rc.partitionRows[k], rc.nullPercent, 100,
+                           rc.mix);
+        }
+        Table out(outTypes);
+        std::vector<uint64> expWords(outTypes.getColumnType(0).getNumericWordCount());
+        VNumeric expected(&expWords[0], outTypes.getColumnType(0).getTypeMod());
+
+        AnalyticFunction *fn = factory->createAnalyticFunction(srv);
+        fn->setup(srv, inTypes);
+        size_t first = 0;
+        for (int k = 0; k < 3; ++k) {
+            const size_t rows = rc.partitionRows[k];
+            char detail[128];
+            snprintf(detail, sizeof(detail),
+                     "NUMERIC(%d,%d), max_rows = %lld, partition %d",
+                     rc.p, rc.s, static_cast<long long>(rc.maxRows), k + 1);
+
+            ReferenceSum frame(rc.p, rc.s);
+            for (size_t r = 0; r < rows; ++r) {
+                table.reader.bindBlock(table.row(first + r), 1);
+                frame.add(table.reader.getNumericRef(0));
+            }
+            const bool tooMany = rc.maxRows > 0 && frame.count > rc.maxRows;
+
+            std::string error;
+            if (!runPartition<AnalyticPartitionReader, AnalyticPartitionWriter>(
+                    srv, fn, table, first, first + rows, out, rows, error)) {
+                check.expect(tooMany && error.find("max_rows") != std::string::npos,
+                             std::string(detail) + ": error " + error);
+                first += rows;
+                continue;
+            }
+            if (tooMany) {
+                check.expect(false, std::string(detail) +
+                                        ": no error for more than max_rows rows");
+                first += rows;
+                continue;
+            }
+
+            ReferenceSum running(rc.p, rc.s);
+            bool ok = true;
+            std::string failure = detail;
+            for (size_t r = 0; r < rows && ok; ++r) {
+                table.reader.bindBlock(table.row(first + r), 1);
+                running.add(table.reader.getNumericRef(0));
+                running.average(expected);
+                out.reader.bindBlock(out.row(r), 1);
+                if (!sameNumeric(out.reader.getNumericRef(0), expected, failure)) {
+                    ok = false;
+                    char at[32];
+                    snprintf(at, sizeof(at), " at row %zu", r + 1);
+                    failure += at;
+                }
+            }
+            check.expect(ok, failure);
+            first += rows;
+        }
+        fn->destroy(srv, inTypes);
+    }
+    return check.done();
+}
+
+/*---------------------------------------------------------------------------
+ * exact_avg_multi
+ *-------------------------------------------------------------------------*/
+
+static const int MAX_MULTI_COLUMNS = 4;
+
+static bool checkAvgMulti()
+{
+    Check check("exact_avg_multi");
+    TransformFunctionFactory *factory = dynamic_cast<TransformFunctionFactory *>(
+        mockFactoryRegistry()["ExactAvgMultiFactory"]);
+
+    struct MultiCase
+    {
+        int columns;
+        int32 p[MAX_MULTI_COLUMNS];
+        int32 s[MAX_MULTI_COLUMNS];
+        vint maxRows; // 0 for no max_rows parameter
+        int nullPercent;
+        ValueMix mix;
+        size_t partitionRows[3];
+        int nullColumn; // all NULL in the second partition, or -1
+    };
+    const MultiCase cases[] = {
+        { 1, {18}, {2}, 0, 5, RANDOM_VALUES, {3000, 1, 2000}, -1 },
+        { 3, {18, 38, 18}, {0, 10, 18}, 0, 10, RANDOM_VALUES, {5000, 40, 700}, 1 },
+        { 4, {18, 75, 300, 1024}, {4, 0, 150, 512}, 0, 20, RANDOM_VALUES,
+          {2000, 300, 1}, 3 },
+        { 2, {38, 1000}, {0, 10}, 0, 5, LARGEST_VALUES, {3000, 2, 500}, 0 },
+        { 2, {1024, 18}, {0, 0}, 0, 5, EXTREME_VALUES, {1000, 30, 800}, -1 },
+        // A max_rows SUM just wide enough; a partition with more non-NULL
+        // rows than max_rows in one argument must fail, and the next one
+        // still work.
+        { 2, {18, 38}, {0, 5}, 1000, 5, LARGEST_VALUES, {1050, 2000, 1000}, -1 },
+        { 3, {75, 18, 38}, {5, 0, 0}, 10, 50, RANDOM_VALUES, {30, 200, 12}, 0 },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        const MultiCase &mc = cases[c];
+        ServerInterface srv;
+        if (mc.maxRows > 0) {
+            srv.getParamReader().setInt("max_rows", mc.maxRows);
+        }
+        SizedColumnTypes inTypes, outTypes;
+        for (int col = 0; col < mc.columns; ++col) {
+            inTypes.addNumeric(mc.p[col], mc.s[col]);
+        }
+        factory->getReturnType(srv, inTypes, outTypes);
+
+        Table table(inTypes);
+        for (int k = 0; k < 3; ++k) {
+            for (size_t r = 0; r < mc.partitionRows[k]; ++r) {
+                BlockReader &row = table.append();
+                for (int col = 0; col < mc.columns; ++col) {
+                    VNumeric &v = row.getNumericRef(col);
+                    if ((k == 1 && col == mc.nullColumn) ||
+                        static_cast<int>(rng() % 100) < mc.nullPercent) {
+                        v.setNull();
+                    } else {
+                        fillNumeric(v, mc.mix);
+                    }
+                }
+            }
+        }
+        Table out(outTypes);
+
+        TransformFunction *fn = factory->createTransformFunction(srv);
+        fn->setup(srv, inTypes);
+        size_t first = 0;
+        for (int k = 0; k < 3; ++k) {
+            const size_t rows = mc.partitionRows[k];
+            char detail[128];
+            snprintf(detail, sizeof(detail),
+                     "%d columns, max_rows = %lld, partition %d", mc.columns,
+                     static_cast<long long>(mc.maxRows), k + 1);
+
+            bool tooMany = false;
+            for (int col = 0; col < mc.columns; ++col) {
+                vint count = 0;
+                for (size_t r = 0; r < rows; ++r) {
+                    table.reader.bindBlock(table.row(first + r), 1);
+                    count += !table.reader.getNumericRef(col).isNull();
+                }
+                tooMany = tooMany || (mc.maxRows > 0 && count > mc.maxRows);
+            }
+
+            std::string error;
+            if (!runPartition<PartitionReader, PartitionWriter>(
+                    srv, fn, table, first, first + rows, out, 1, error)) {
+                check.expect(tooMany && error.find("max_rows") != std::string::npos &&
+                                 reportedAs(error, "exact_avg_multi"),
+                             std::string(detail) + ": error " + error);
+                first += rows;
+                continue;
+            }
+            if (tooMany) {
+                check.expect(false, std::string(detail) +
+                                        ": no error for more than max_rows rows");
+                first += rows;
+                continue;
+            }
+
+            bool ok = true;
+            std::string failure = detail;
+            out.reader.bindBlock(out.row(0), 1);
+            for (int col = 0; col < mc.columns && ok; ++col) {
+                ReferenceSum total(mc.p[col], mc.s[col]);
+                for (size_t r = 0; r < rows; ++r) {
+                    table.reader.bindBlock(table.row(first + r), 1);
+                    total.add(table.reader.getNumericRef(col));
+                }
+                const VerticaType &outType = outTypes.getColumnType(col);
+                std::vector<uint64> expWords(outType.getNumericWordCount());
+                VNumeric expected(&expWords[0], outType.getTypeMod());
+                total.average(expected);
+                if (!sameNumeric(out.reader.getNumericRef(col), expected, failure)) {
+                    ok = false;
+                    char at[32];
+                    snprintf(at, sizeof(at), " in argument %d", col + 1);
+                    failure += at;
+                }
+            }
+            check.expect(ok, failure);
+            first += rows;
+        }
+        fn->destroy(srv, inTypes);
+    }
+    return check.done();
+}
+
+/*---------------------------------------------------------------------------
+ * exact_sum
+ *-------------------------------------------------------------------------*/
+
+static bool checkSum()
+{
+    Check check("exact_sum");
+    AggregateFunctionFactory *factory = dynamic_cast<AggregateFunctionFactory *>(
+        mockFactoryRegistry()["ExactSumFactory"]);
+
+    struct SumCase
+    {
+        int32 p;
+        int32 s;
+        vint maxRows; // 0 for no max_rows parameter
+        size_t rows;
+        ValueMix mix;
+    };
+    const SumCase cases[] = {
+        { 18, 2, 0, 3000, RANDOM_VALUES },
+        { 38, 0, 0, 5000, LARGEST_VALUES },
+        { 1000, 10, 0, 2000, RANDOM_VALUES },
+        // A VARBINARY SUM clamped to NUMERIC(1024): it fits for one row of
+        // the largest value, not for two.
+        { 1024, 0, 0, 1, LARGEST_VALUES },
+        { 1024, 0, 0, 2, LARGEST_VALUES },
+        { 1024, 1024, 0, 3000, RANDOM_VALUES },
+        // More non-NULL rows than max_rows.
+        { 75, 5, 10, 20, RANDOM_VALUES },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        const SumCase &sc = cases[c];
+        ServerInterface srv;
+        if (sc.maxRows > 0) {
+            srv.getParamReader().setInt("max_rows", sc.maxRows);
+        }
+        SizedColumnTypes inTypes, outTypes;
+        inTypes.addNumeric(sc.p, sc.s, "a");
+        factory->getReturnType(srv, inTypes, outTypes);
+
+        Table table(inTypes);
+        appendNumerics(table, sc.rows, 5, 3, sc.mix);
+        ReferenceSum total(sc.p, sc.s);
+        for (size_t r = 0; r < table.rows; ++r) {
+            table.reader.bindBlock(table.row(r), 1);
+            total.add(table.reader.getNumericRef(0));
+        }
+
+        // The SUM fits if the stand-in's VNumeric can hold it at the result
+        // type.
+        const VerticaType &outType = outTypes.getColumnType(0);
+        std::vector<uint64> expWords(outType.getNumericWordCount());
+        VNumeric expected(&expWords[0], outType.getTypeMod());
+        bool fits = sc.maxRows == 0 || total.count <= sc.maxRows;
+        try {
+            expected.copy(&total.sum);
+        } catch (std::exception &) {
+            fits = false;
+        }
+        if (total.count == 0) {
+            expected.setNull();
+        }
+
+        char detail[128];
+        snprintf(detail, sizeof(detail), "NUMERIC(%d,%d), %zu rows, max_rows = %lld",
+                 sc.p, sc.s, sc.rows, static_cast<long long>(sc.maxRows));
+        std::vector<char> outRow;
+        std::string error;
+        if (!runAggregate(srv, factory, table, outTypes, outRow, error)) {
+            check.expect(!fits && reportedAs(error, "exact_sum"),
+                         std::string(detail) + ", got error " + error);
+            continue;
+        }
+        std::string failure = detail;
+        if (!fits) {
+            check.expect(false, failure + ", expected an error");
+            continue;
+        }
+        BlockWriter writer;
+        writer.bindLayout(outTypes);
+        writer.bindBase(&outRow[0]);
+        check.expect(sameNumeric(writer.getNumericRef(0), expected, failure), failure);
+    }
+
+    // The argument and parameter checks it inherits from ExactAvgFactory
+    // report as exact_sum too.
+    checkTypeErrors(check, factory, "exact_sum", 1);
+    return check.done();
+}
+
+/*---------------------------------------------------------------------------
+ * exact_var_pop, exact_var_samp, exact_stddev
+ *-------------------------------------------------------------------------*/
+
+// Compares num with (root + u/2)^2 den, or (root - u/2)^2 den when below is
+// set, for u a unit in root's last place; the products are exact at any
+// scale of den.
+static int compareWithSquare(const VNumeric &num, const VNumeric &den,
+                             const VNumeric &root, bool below)
+{
+    const int32 s = root.getScale();
+    uint64 five = 5;
+    const VNumeric half(&five, 18, s + 1);
+    RefNumeric bound(s + 1), square(2 * s + 2);
+    RefNumeric scaled(2 * s + 2 + den.getScale());
+    if (below) {
+        bound.value.sub(&root, &half);
+    } else {
+        bound.value.add(&root, &half);
+    }
+    square.value.mul(&bound.value, &bound.value);
+    scaled.value.mul(&square.value, &den);
+    return num.compare(&scaled.value);
+}
+
+// Whether root, a non-negative NUMERIC, is sqrt(num / den) rounded half up:
+// num / den lies in [(root - u/2)^2, (root + u/2)^2), or below (u/2)^2 when
+// root is 0.
+static bool isRoundedRoot(const VNumeric &root, const VNumeric &num,
+                          const VNumeric &den)
+{
+    return compareWithSquare(num, den, root, false) < 0 &&
+           (root.isZero() || compareWithSquare(num, den, root, true) >= 0);
+}
+
+static bool checkMoments()
+{
+    static const char *const factories[] = {
+        "ExactVarPopFactory", "ExactVarSampFactory", "ExactStddevFactory" };
+    static const char *const names[] = {
+        "exact_var_pop", "exact_var_samp", "exact_stddev" };
+
+    struct MomentCase
+    {
+        int32 p;
+        int32 s;
+        vint maxRows; // 0 for no max_rows parameter
+        size_t rows;
+        ValueMix mix;
+    };
+    const MomentCase cases[] = {
+        // No rows, one row (NULL but for exact_var_pop), equal rows.
+        { 18, 2, 0, 0, RANDOM_VALUES },
+        { 38, 5, 0, 1, RANDOM_VALUES },
+        { 38, 0, 0, 500, LARGEST_VALUES },
+        // The int128 lane and the SquareSumBlock lanes, 1 to 54 words wide.
+        { 18, 2, 0, 3000, RANDOM_VALUES },
+        { 18, 0, 0, 3000, CLUSTERED_VALUES },
+        { 38, 10, 0, 3000, RANDOM_VALUES },
+        { 75, 0, 0, 3000, CLUSTERED_VALUES },
+        { 300, 150, 0, 2000, RANDOM_VALUES },
+        // SUM(a^2) in a VARBINARY from p_in = 503; both SUMs from 1006.
+        { 503, 3, 0, 2000, RANDOM_VALUES },
+        { 1000, 500, 0, 1000, CLUSTERED_VALUES },
+        { 1024, 1000, 0, 1000, RANDOM_VALUES },
+        // The largest spreads: VAR_SAMP of +/-M is 2 M^2.
+        { 18, 0, 0, 1000, EXTREME_VALUES },
+        { 300, 300, 0, 50, EXTREME_VALUES },
+        // Results clamped to NUMERIC(1024) that may not fit.
+        { 1024, 0, 0, 300, RANDOM_VALUES },
+        { 1024, 0, 0, 2, CLUSTERED_VALUES },
+        { 1024, 0, 0, 2, EXTREME_VALUES },
+        { 1024, 0, 0, 40, EXTREME_VALUES },
+        // max_rows SUMs: filled exactly, and exceeded.
+        { 18, 2, 1000, 1000, LARGEST_VALUES },
+        { 300, 0, 100, 80, CLUSTERED_VALUES },
+        { 38, 0, 10, 40, RANDOM_VALUES },
+    };
+
+    bool ok = true;
+    for (int kind = 0; kind < 3; ++kind) {
+        Check check(names[kind]);
+        AggregateFunctionFactory *factory = dynamic_cast<AggregateFunctionFactory *>(
+            mockFactoryRegistry()[factories[kind]]);
+        const bool stddev = kind == 2;
+
+        for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+            const MomentCase &mc = cases[c];
+            ServerInterface srv;
+            if (mc.maxRows > 0) {
+                srv.getParamReader().setInt("max_rows", mc.maxRows);
+            }
+            SizedColumnTypes inTypes, outTypes;
+            inTypes.addNumeric(mc.p, mc.s, "a");
+            factory->getReturnType(srv, inTypes, outTypes);
+            const VerticaType &outType = outTypes.getColumnType(0);
+
+            Table table(inTypes);
+            appendNumerics(table, mc.rows, 5, 3, mc.mix);
+
+            // num = n SUM(a^2) - SUM(a)^2 at scale 2 s, den = n^2 or
+            // n (n - 1).
+            RefNumeric sum(mc.s), sumSq(2 * mc.s), square(2 * mc.s);
+            vint n = 0;
+            for (size_t r = 0; r < table.rows; ++r) {
+                table.reader.bindBlock(table.row(r), 1);
+                const VNumeric &v = table.reader.getNumericRef(0);
+                if (!v.isNull()) {
+                    sum.value.accumulate(&v);
+                    square.value.mul(&v, &v);
+                    sumSq.value.accumulate(&square.value);
+                    n++;
+                }
+            }
+            RefNumeric count(0), num(2 * mc.s), den(0);
+            count.value.copy(n);
+            num.value.mul(&count.value, &sumSq.value);
+            square.value.mul(&sum.value, &sum.value);
+            num.value.sub(&num.value, &square.value);
+            den.value.copy(n * (kind == 0 ? n : n - 1));
+
+            const bool tooMany = mc.maxRows > 0 && n > mc.maxRows;
+            const bool isNull = n == 0 || (n == 1 && kind != 0);
+
+            // The result fits unless it rounds to 10^(p_out - s_out) or
+            // more: for the variances, unless the stand-in's VNumeric
+            // cannot hold the quotient; for exact_stddev, unless num / den
+            // reaches (10^(p_out - s_out) - u/2)^2.
+            std::vector<uint64> expWords(outType.getNumericWordCount());
+            VNumeric expected(&expWords[0], outType.getTypeMod());
+            bool fits = true;
+            if (isNull) {
+                expected.setNull();
+            } else if (!stddev) {
+                try {
+                    expected.div(&num.value, &den.value);
+                } catch (std::exception &) {
+                    fits = false;
+                }
+            } else {
+                largestNumeric(expected);
+                fits = compareWithSquare(num.value, den.value, expected, false) < 0;
+            }
+
+            char detail[160];
+            snprintf(detail, sizeof(detail),
+                     "NUMERIC(%d,%d), %zu rows, max_rows = %lld",
+                     mc.p, mc.s, mc.rows, static_cast<long long>(mc.maxRows));
+            std::string failure = detail;
+            std::vector<char> outRow;
+            std::string error;
+            if (!runAggregate(srv, factory, table, outTypes, outRow, error)) {
+                const bool expectedError = tooMany
+                    ? error.find("max_rows") != std::string::npos
+                    : !isNull && !fits &&
+                          error.find("does not fit") != std::string::npos;
+                check.expect(expectedError && reportedAs(error, names[kind]),
+                             failure + ", got error " + error);
+                continue;
+            }
+            if (tooMany || (!isNull && !fits)) {
+                check.expect(false, failure + ", expected an error");
+                continue;
+            }
+
+            BlockWriter writer;
+            writer.bindLayout(outTypes);
+            writer.bindBase(&outRow[0]);
+            const VNumeric &got = writer.getNumericRef(0);
+            if (isNull || !stddev) {
+                check.expect(sameNumeric(got, expected, failure), failure);
+            } else {
+                const bool rounded = !got.isNull() && !got.isNeg() &&
+                                     isRoundedRoot(got, num.value, den.value);
+                check.expect(rounded, failure + ", got " + got.toString() +
+                                          ", not the rounded square root");
+            }
+        }
+        checkTypeErrors(check, factory, names[kind], 1);
+        ok = check.done() && ok;
+    }
+    return ok;
+}
+
+/*---------------------------------------------------------------------------
+ * exact_covar_pop, exact_corr, exact_regr_slope
+ *-------------------------------------------------------------------------*/
+
+// How the y of each pair relates to its x.
+enum PairMix
+{
+    INDEPENDENT_PAIRS, // y and x drawn separately
+    Y_IS_X,            // y = x: exact_corr and exact_regr_slope are 1
+    Y_IS_MINUS_X,      // y = -x: both are -1
+    CONSTANT_X         // every x the same: Cxx = 0
+};
+
+static bool checkPairs()
+{
+    static const char *const factories[] = {
+        "ExactCovarPopFactory", "ExactCorrFactory", "ExactRegrSlopeFactory" };
+    static const char *const names[] = {
+        "exact_covar_pop", "exact_corr", "exact_regr_slope" };
+
+    struct PairCase
+    {
+        int32 p_y;
+        int32 s_y;
+        int32 p_x;
+        int32 s_x;
+        vint maxRows; // 0 for no max_rows parameter
+        size_t rows;
+        ValueMix mix;
+        PairMix pairs;
+    };
+    const PairCase cases[] = {
+        // No pairs; one pair (Cxx = 0).
+        { 18, 2, 18, 2, 0, 0, RANDOM_VALUES, INDEPENDENT_PAIRS },
+        { 38, 0, 18, 4, 0, 1, RANDOM_VALUES, INDEPENDENT_PAIRS },
+        // The int128 lane, and lanes as wide as the wider of y and x.
+        { 18, 2, 18, 2, 0, 3000, RANDOM_VALUES, INDEPENDENT_PAIRS },
+        { 18, 0, 18, 0, 0, 3000, EXTREME_VALUES, INDEPENDENT_PAIRS },
+        { 38, 5, 18, 2, 0, 3000, RANDOM_VALUES, INDEPENDENT_PAIRS },
+        { 18, 0, 75, 30, 0, 3000, CLUSTERED_VALUES, INDEPENDENT_PAIRS },
+        { 300, 100, 300, 100, 0, 1000, CLUSTERED_VALUES, Y_IS_X },
+        { 75, 0, 75, 0, 0, 1000, RANDOM_VALUES, Y_IS_MINUS_X },
+        { 38, 0, 38, 10, 0, 500, RANDOM_VALUES, CONSTANT_X },
+        // VARBINARY SUM(x y), SUM(x^2) and SUM(y^2) from p = 503.
+        { 503, 0, 503, 3, 0, 500, RANDOM_VALUES, INDEPENDENT_PAIRS },
+        { 1024, 512, 20, 0, 0, 500, RANDOM_VALUES, INDEPENDENT_PAIRS },
+        // Results clamped to NUMERIC(1024) that may not fit.
+        { 1024, 0, 1024, 0, 0, 300, EXTREME_VALUES, INDEPENDENT_PAIRS },
+        { 1024, 0, 1024, 1024, 0, 300, RANDOM_VALUES, INDEPENDENT_PAIRS },
+        // max_rows SUMs: filled exactly, and exceeded.
+        { 18, 0, 18, 0, 1000, 1000, EXTREME_VALUES, INDEPENDENT_PAIRS },
+        { 38, 0, 38, 0, 10, 40, RANDOM_VALUES, INDEPENDENT_PAIRS },
+    };
+
+    bool ok = true;
+    for (int kind = 0; kind < 3; ++kind) {
+        Check check(names[kind]);
+        AggregateFunctionFactory *factory = dynamic_cast<AggregateFunctionFactory *>(
+            mockFactoryRegistry()[factories[kind]]);
+
+        for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+            const PairCase &pc = cases[c];
+            ServerInterface srv;
+            if (pc.maxRows > 0) {
+                srv.getParamReader().setInt("max_rows", pc.maxRows);
+            }
+            SizedColumnTypes inTypes, outTypes;
+            inTypes.addNumeric(pc.p_y, pc.s_y, "y");
+            inTypes.addNumeric(pc.p_x, pc.s_x, "x");
+            factory->getReturnType(srv, inTypes, outTypes);
+            const VerticaType &outType = outTypes.getColumnType(0);
+
+            // One pair in twenty has a NULL y or x and is skipped.
+            Table table(inTypes);
+            std::vector<uint64> constantWords(VNumeric::getNumericWordCount(pc.p_x));
+            VNumeric constant(&constantWords[0], pc.p_x, pc.s_x);
+            fillNumeric(constant, pc.mix);
+            for (size_t r = 0; r < pc.rows; ++r) {
+                BlockReader &row = table.append();
+                VNumeric &y = row.getNumericRef(0);
+                VNumeric &x = row.getNumericRef(1);
+                if (pc.pairs == CONSTANT_X) {
+                    x.copy(&constant);
+                } else {
+                    fillNumeric(x, pc.mix);
+                }
+                if (pc.pairs == Y_IS_X || pc.pairs == Y_IS_MINUS_X) {
+                    y.copy(&x);
+                    if (pc.pairs == Y_IS_MINUS_X) {
+                        y.negate();
+                    }
+                } else {
+                    fillNumeric(y, pc.mix);
+                }
+                if (rng() % 20 == 0) {
+                    (rng() % 2 ? y : x).setNull();
+                }
+            }
+
+            // Cab = n SUM(a b) - SUM(a) SUM(b), each at the scale of a b.
+            RefNumeric sumY(pc.s_y), sumX(pc.s_x), product(pc.s_x + pc.s_y);
+            RefNumeric sumXY(pc.s_x + pc.s_y), sumXX(2 * pc.s_x), sumYY(2 * pc.s_y);
+            RefNumeric xx(2 * pc.s_x), yy(2 * pc.s_y);
+            vint n = 0;
+            for (size_t r = 0; r < table.rows; ++r) {
+                table.reader.bindBlock(table.row(r), 1);
+                const VNumeric &y = table.reader.getNumericRef(0);
+                const VNumeric &x = table.reader.getNumericRef(1);
+                if (y.isNull() || x.isNull()) {
+                    continue;
+                }
+                sumY.value.accumulate(&y);
+                sumX.value.accumulate(&x);
+                product.value.mul(&x, &y);
+                sumXY.value.accumulate(&product.value);
+                xx.value.mul(&x, &x);
+                sumXX.value.accumulate(&xx.value);
+                yy.value.mul(&y, &y);
+                sumYY.value.accumulate(&yy.value);
+                n++;
+            }
+            RefNumeric count(0), cxy(pc.s_x + pc.s_y), cxx(2 * pc.s_x);
+            RefNumeric cyy(2 * pc.s_y);
+            count.value.copy(n);
+            cxy.value.mul(&count.value, &sumXY.value);
+            product.value.mul(&sumX.value, &sumY.value);
+            cxy.value.sub(&cxy.value, &product.value);
+            cxx.value.mul(&count.value, &sumXX.value);
+            xx.value.mul(&sumX.value, &sumX.value);
+            cxx.value.sub(&cxx.value, &xx.value);
+            cyy.value.mul(&count.value, &sumYY.value);
+            yy.value.mul(&sumY.value, &sumY.value);
+            cyy.value.sub(&cyy.value, &yy.value);
+
+            const bool tooMany = pc.maxRows > 0 && n > pc.maxRows;
+            const bool isNull = n == 0 ||
+                (kind != 0 && cxx.value.isZero()) ||
+                (kind == 1 && cyy.value.isZero());
+
+            // exact_corr always fits (|corr| <= 1); the others fit if the
+            // stand-in's VNumeric can hold the quotient.
+            std::vector<uint64> expWords(outType.getNumericWordCount());
+            VNumeric expected(&expWords[0], outType.getTypeMod());
+            RefNumeric corrNum(2 * (pc.s_x + pc.s_y));
+            RefNumeric corrDen(2 * (pc.s_x + pc.s_y));
+            bool fits = true;
+            if (isNull) {
+                expected.setNull();
+            } else if (kind == 1) {
+                corrNum.value.mul(&cxy.value, &cxy.value);
+                corrDen.value.mul(&cxx.value, &cyy.value);
+            } else {
+                RefNumeric den(kind == 0 ? 0 : 2 * pc.s_x);
+                if (kind == 0) {
+                    den.value.copy(n * n);
+                } else {
+                    den.value.copy(&cxx.value);
+                }
+                try {
+                    expected.div(&cxy.value, &den.value);
+                } catch (std::exception &) {
+                    fits = false;
+                }
+            }
+
+            char detail[160];
+            snprintf(detail, sizeof(detail),
+                     "y NUMERIC(%d,%d), x NUMERIC(%d,%d), %zu rows, max_rows = %lld",
+                     pc.p_y, pc.s_y, pc.p_x, pc.s_x, pc.rows,
+                     static_cast<long long>(pc.maxRows));
+            std::string failure = detail;
+            std::vector<char> outRow;
+            std::string error;
+            if (!runAggregate(srv, factory, table, outTypes, outRow, error)) {
+                const bool expectedError = tooMany
+                    ? error.find("max_rows") != std::string::npos
+                    : !isNull && !fits &&
+                          error.find("does not fit") != std::string::npos;
+                check.expect(expectedError && reportedAs(error, names[kind]),
+                             failure + ", got error " + error);
+                continue;
+            }
+            if (tooMany || (!isNull && !fits)) {
+                check.expect(false, failure + ", expected an error");
+                continue;
+            }
+
+            BlockWriter writer;
+            writer.bindLayout(outTypes);
+            writer.bindBase(&outRow[0]);
+            const VNumeric &got = writer.getNumericRef(0);
+            if (isNull || kind != 1) {
+                check.expect(sameNumeric(got, expected, failure), failure);
+                continue;
+            }
+            // exact_corr: the sign of Cxy and a correctly rounded magnitude.
+            bool rounded = !got.isNull() &&
+                (got.isZero() || got.isNeg() == cxy.value.isNeg());
+            if (rounded) {
+                RefNumeric magnitude(got.getScale());
+                magnitude.value.copy(&got);
+                if (magnitude.value.isNeg()) {
+                    magnitude.value.negate();
+                }
+                rounded = isRoundedRoot(magnitude.value, corrNum.value,
+                                        corrDen.value);
+            }
+            check.expect(rounded, failure + ", got " + got.toString() +
+                                      ", not the rounded correlation");
+        }
+        checkTypeErrors(check, factory, names[kind], 2);
+        ok = check.done() && ok;
+    }
+    return ok;
+}
+
+/*---------------------------------------------------------------------------
+ * exact_wavg
+ *-------------------------------------------------------------------------*/
+
+// The signs of the weights.
+enum WeightMix
+{
+    POSITIVE_WEIGHTS,   // the result lies within the values and always fits
+    MIXED_WEIGHTS,      // random signs
+    CANCELLING_WEIGHTS, // each weight followed by its negation: SUM(w) = 0
+    NEARLY_CANCELLING   // as above plus one weight of one ulp
+};
+
+static bool checkWavg()
+{
+    Check check("exact_wavg");
+    AggregateFunctionFactory *factory = dynamic_cast<AggregateFunctionFactory *>(
+        mockFactoryRegistry()["ExactWavgFactory"]);
+
+    struct WavgCase
+    {
+        int32 p_v;
+        int32 s_v;
+        int32 p_w;
+        int32 s_w;
+        vint maxRows; // 0 for no max_rows parameter
+        size_t rows;
+        ValueMix mix;
+        WeightMix weights;
+    };
+    const WavgCase cases[] = {
+        { 18, 2, 18, 0, 0, 0, RANDOM_VALUES, POSITIVE_WEIGHTS },
+        // The int128 lane, and lanes as wide as the wider of v and w.
+        { 18, 2, 18, 0, 0, 3000, RANDOM_VALUES, POSITIVE_WEIGHTS },
+        { 18, 0, 18, 3, 0, 3000, EXTREME_VALUES, MIXED_WEIGHTS },
+        { 38, 6, 18, 2, 0, 3000, CLUSTERED_VALUES, POSITIVE_WEIGHTS },
+        { 18, 0, 75, 20, 0, 3000, RANDOM_VALUES, MIXED_WEIGHTS },
+        { 300, 150, 38, 0, 0, 1000, RANDOM_VALUES, MIXED_WEIGHTS },
+        // SUM(w) = 0 gives NULL; one ulp of SUM(w) a result far too wide.
+        { 38, 0, 38, 0, 0, 1000, RANDOM_VALUES, CANCELLING_WEIGHTS },
+        { 38, 0, 38, 5, 0, 1000, EXTREME_VALUES, NEARLY_CANCELLING },
+        { 18, 2, 18, 18, 0, 1, RANDOM_VALUES, NEARLY_CANCELLING },
+        // VARBINARY SUM(v w) from p_v + p_w = 1006; both SUMs from 1024.
+        { 503, 3, 503, 0, 0, 1000, RANDOM_VALUES, POSITIVE_WEIGHTS },
+        { 1024, 512, 1024, 1000, 0, 500, EXTREME_VALUES, MIXED_WEIGHTS },
+        { 1024, 0, 1024, 0, 0, 500, EXTREME_VALUES, NEARLY_CANCELLING },
+        // max_rows SUMs: filled exactly, and exceeded.
+        { 18, 0, 18, 0, 1000, 1000, EXTREME_VALUES, POSITIVE_WEIGHTS },
+        { 38, 0, 38, 0, 10, 40, RANDOM_VALUES, MIXED_WEIGHTS },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        const WavgCase &wc = cases[c];
+        ServerInterface srv;
+        if (wc.maxRows > 0) {
+            srv.getParamReader().setInt("max_rows", wc.maxRows);
+        }
+        SizedColumnTypes inTypes, outTypes;
+        inTypes.addNumeric(wc.p_v, wc.s_v, "v");
+        inTypes.addNumeric(wc.p_w, wc.s_w, "w");
+        factory->getReturnType(srv, inTypes, outTypes);
+
+        // One row in twenty has a NULL v or w and is skipped, except where
+        // the weights must cancel.
+        const bool cancelling = wc.weights == CANCELLING_WEIGHTS ||
+                                wc.weights == NEARLY_CANCELLING;
+        // The one-ulp weight comes first, the cancelling pairs after it.
+        const size_t pairsFrom = wc.weights == NEARLY_CANCELLING ? 1 : 0;
+        Table table(inTypes);
+        std::vector<uint64> lastWords(VNumeric::getNumericWordCount(wc.p_w));
+        VNumeric last(&lastWords[0], wc.p_w, wc.s_w);
+        for (size_t r = 0; r < wc.rows; ++r) {
+            BlockReader &row = table.append();
+            VNumeric &v = row.getNumericRef(0);
+            VNumeric &w = row.getNumericRef(1);
+            fillNumeric(v, wc.mix);
+            if (r < pairsFrom) {
+                w.setZero();
+                w.words[w.nwds - 1] = 1;
+            } else if (cancelling && (r - pairsFrom) % 2 == 1) {
+                w.copy(&last);
+                w.negate();
+            } else {
+                randomNumeric(w);
+                if (wc.weights == POSITIVE_WEIGHTS && w.isNeg()) {
+                    w.negate();
+                }
+                last.copy(&w);
+            }
+            if (!cancelling && rng() % 20 == 0) {
+                (rng() % 2 ? v : w).setNull();
+            }
+        }
+
+        RefNumeric sumVW(wc.s_v + wc.s_w), sumW(wc.s_w), product(wc.s_v + wc.s_w);
+        vint n = 0;
+        for (size_t r = 0; r < table.rows; ++r) {
+            table.reader.bindBlock(table.row(r), 1);
+            const VNumeric &v = table.reader.getNumericRef(0);
+            const VNumeric &w = table.reader.getNumericRef(1);
+            if (v.isNull() || w.isNull()) {
+                continue;
+            }
+            product.value.mul(&v, &w);
+            sumVW.value.accumulate(&product.value);
+            sumW.value.accumulate(&w);
+            n++;
+        }
+
+        // The result fits if the stand-in's VNumeric can hold the quotient.
+        const bool tooMany = wc.maxRows > 0 && n > wc.maxRows;
+        const bool isNull = n == 0 || sumW.value.isZero();
+        const VerticaType &outType = outTypes.getColumnType(0);
+        std::vector<uint64> expWords(outType.getNumericWordCount());
+        VNumeric expected(&expWords[0], outType.getTypeMod());
+        bool fits = true;
+        if (isNull) {
+            expected.setNull();
+        } else {
+            try {
+                expected.div(&sumVW.value, &sumW.value);
+            } catch (std::exception &) {
+                fits = false;
+            }
+        }
+
+        char detail[160];
+        snprintf(detail, sizeof(detail),
+                 "v NUMERIC(%d,%d), w NUMERIC(%d,%d), %zu rows, max_rows = %lld",
+                 wc.p_v, wc.s_v, wc.p_w, wc.s_w, wc.rows,
+                 static_cast<long long>(wc.maxRows));
+        std::string failure = detail;
+        std::vector<char> outRow;
+        std::string error;
+        if (!runAggregate(srv, factory, table, outTypes, outRow, error)) {
+            const bool expectedError = tooMany
+                ? error.find("max_rows") != std::string::npos
+                : !isNull && !fits &&
+                      error.find("does not fit") != std::string::npos &&
+                      error.find("mixed signs") != std::string::npos;
+            check.expect(expectedError && reportedAs(error, "exact_wavg"),
+                         failure + ", got error " + error);
+            continue;
+        }
+        if (tooMany || !fits) {
+            check.expect(false, failure + ", expected an error");
+            continue;
+        }
+        BlockWriter writer;
+        writer.bindLayout(outTypes);
+        writer.bindBase(&outRow[0]);
+        check.expect(sameNumeric(writer.getNumericRef(0), expected, failure), failure);
+    }
+    checkTypeErrors(check, factory, "exact_wavg", 2);
+    return check.done();
+}
+
+int main(int argc, char **argv)
+{
+    rng.seed(argc > 1 ? strtoull(argv[1], 0, 10) : 42);
+
+    bool ok = true;
+    ok = checkFloatAverage() && ok;
+    ok = checkMovingAverage() && ok;
+    ok = checkRunningAverage() && ok;
+    ok = checkAvgMulti() && ok;
+    ok = checkSum() && ok;
+    ok = checkMoments() && ok;
+    ok = checkPairs() && ok;
+    ok = checkWavg() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,610 @@
+/*
+ * Out-of-line parts of the offline Vertica SDK stand-in (see Vertica.h).
+ *
+ * The NUMERIC arithmetic here is written for obviousness rather than speed:
+ * it converts to sign + base-2^32 magnitude, works on that, and converts back.
+ * VNumeric::accumulate() is the exception, since it sits on the per-row path
+ * of the code being benchmarked and must not distort the numbers.
+ */
+#include "Vertica.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace Vertica
+{
+
+std::string vt_format(const char *fmt, ...)
+{
+    char buf[4096];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return std::string(buf);
+}
+
+void ServerInterface::log(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+/*---------------------------------------------------------------------------
+ * VTAllocator
+ *-------------------------------------------------------------------------*/
+
+VTAllocator::~VTAllocator()
+{
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        free(chunks[i]);
+    }
+}
+
+void *VTAllocator::alloc(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    chunks.push_back(p);
+    bytes += size;
+    return p;
+}
+
+std::map<std::string, UDXFactory *> &mockFactoryRegistry()
+{
+    static std::map<std::string, UDXFactory *> registry;
+    return registry;
+}
+
+/*---------------------------------------------------------------------------
+ * Sign + magnitude helpers for the reference NUMERIC arithmetic
+ *-------------------------------------------------------------------------*/
+
+namespace
+{
+
+typedef std::vector<uint32> Mag; // little-endian base 2^32
+
+struct Big
+{
+    bool neg;
+    Mag mag;
+};
+
+void trim(Mag &m)
+{
+    while (!m.empty() && m.back() == 0) m.pop_back();
+}
+
+Big fromWords(const uint64 *w, int32 n)
+{
+    Big b;
+    b.neg = static_cast<int64>(w[0]) < 0;
+    std::vector<uint64> t(w, w + n);
+    if (b.neg) {
+        uint64 carry = 1;
+        for (int32 i = n - 1; i >= 0; --i) {
+            t[i] = ~t[i] + carry;
+            carry = (carry && t[i] == 0) ? 1 : 0;
+        }
+    }
+    for (int32 i = n - 1; i >= 0; --i) {
+        b.mag.push_back(static_cast<uint32>(t[i]));
+        b.mag.push_back(static_cast<uint32>(t[i] >> 32));
+    }
+    trim(b.mag);
+    if (b.mag.empty()) b.neg = false;
+    return b;
+}
+
+void toWords(const Big &b, uint64 *w, int32 n)
+{
+    if (b.mag.size() > static_cast<size_t>(2 * n)) {
+        vt_report_error(0, "numeric value out of range (word overflow)");
+    }
+    for (int32 i = 0; i < n; ++i) {
+        size_t lo = 2 * static_cast<size_t>(n - 1 - i);
+        uint64 v = 0;
+        if (lo < b.mag.size()) v |= b.mag[lo];
+        if (lo + 1 < b.mag.size()) v |= static_cast<uint64>(b.mag[lo + 1]) << 32;
+        w[i] = v;
+    }
+    if (static_cast<int64>(w[0]) < 0 && !(b.neg && w[0] == 0x8000000000000000ULL)) {
+        vt_report_error(0, "numeric value out of range (sign overflow)");
+    }
+    if (b.neg) {
+        uint64 carry = 1;
+        for (int32 i = n - 1; i >= 0; --i) {
+            w[i] = ~w[i] + carry;
+            carry = (carry && w[i] == 0) ? 1 : 0;
+        }
+    }
+}
+
+int cmpMag(const Mag &a, const Mag &b)
+{
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (size_t i = a.size(); i-- > 0;) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+Mag addMag(const Mag &a, const Mag &b)
+{
+    Mag r(std::max(a.size(), b.size()) + 1, 0);
+    uint64 carry = 0;
+    for (size_t i = 0; i < r.size(); ++i) {
+        uint64 s = carry;
+        if (i < a.size()) s += a[i];
+        if (i < b.size()) s += b[i];
+        r[i] = static_cast<uint32>(s);
+        carry = s >> 32;
+    }
+    trim(r);
+    return r;
+}
+
+// Requires a >= b.
+Mag subMag(const Mag &a, const Mag &b)
+{
+    Mag r(a.size(), 0);
+    int64 borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int64 d = static_cast<int64>(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+        borrow = d < 0 ? 1 : 0;
+        r[i] = static_cast<uint32>(d + (borrow << 32));
+    }
+    trim(r);
+    return r;
+}
+
+Mag mulMag(const Mag &a, const Mag &b)
+{
+    if (a.empty() || b.empty()) return Mag();
+    Mag r(a.size() + b.size(), 0);
+    for (size_t i = 0; i < a.size(); ++i) {
+        uint64 carry = 0;
+        for (size_t j = 0; j < b.size(); ++j) {
+            uint64 t = static_cast<uint64>(a[i]) * b[j] + r[i + j] + carry;
+            r[i + j] = static_cast<uint32>(t);
+            carry = t >> 32;
+        }
+        r[i + b.size()] = static_cast<uint32>(carry);
+    }
+    trim(r);
+    return r;
+}
+
+// 10^e, memoized: every store() compares against 10^precision, and the
+// checks' reference arithmetic runs at thousands of digits.
+const Mag &pow10Mag(int32 e)
+{
+    static std::map<int32, Mag> powers;
+    std::map<int32, Mag>::iterator it = powers.find(e);
+    if (it != powers.end()) return it->second;
+    Mag r(1, 1);
+    Mag ten(1, 10);
+    for (int32 i = 0; i < e; ++i) r = mulMag(r, ten);
+    return powers[e] = r;
+}
+
+// Knuth algorithm D (after Hacker's Delight divmnu).  b must be non-zero.
+void divMag(const Mag &a, const Mag &b, Mag &q, Mag &r)
+{
+    if (cmpMag(a, b) < 0) {
+        q.clear();
+        r = a;
+        return;
+    }
+    size_t m = a.size(), n = b.size();
+    if (n == 1) {
+        q.assign(m, 0);
+        uint64 rem = 0;
+        for (size_t i = m; i-- > 0;) {
+            uint64 cur = (rem << 32) | a[i];
+            q[i] = static_cast<uint32>(cur / b[0]);
+            rem = cur % b[0];
+        }
+        trim(q);
+        r.assign(1, static_cast<uint32>(rem));
+        trim(r);
+        return;
+    }
+    int s = __builtin_clz(b[n - 1]);
+    Mag vn(n), un(m + 1);
+    for (size_t i = n - 1; i > 0; --i)
+        vn[i] = (b[i] << s) | (s ? static_cast<uint32>(static_cast<uint64>(b[i - 1]) >> (32 - s)) : 0);
+    vn[0] = b[0] << s;
+    un[m] = s ? static_cast<uint32>(static_cast<uint64>(a[m - 1]) >> (32 - s)) : 0;
+    for (size_t i = m - 1; i > 0; --i)
+        un[i] = (a[i] << s) | (s ? static_cast<uint32>(static_cast<uint64>(a[i - 1]) >> (32 - s)) : 0);
+    un[0] = a[0] << s;
+
+    q.assign(m - n + 1, 0);
+    const uint64 B = 1ULL << 32;
+    for (size_t j = m - n + 1; j-- > 0;) {
+        uint64 num = (static_cast<uint64>(un[j + n]) << 32) | un[j + n - 1];
+        uint64 qhat = num / vn[n - 1];
+        uint64 rhat = num % vn[n - 1];
+        while (qhat >= B || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+            --qhat;
+            rhat += vn[n - 1];
+            if (rhat >= B) break;
+        }
+        int64 k = 0, t;
+        for (size_t i = 0; i < n; ++i) {
+            uint64 p = qhat * vn[i];
+            t = static_cast<int64>(un[i + j]) - k - static_cast<int64>(p & 0xFFFFFFFFULL);
+            un[i + j] = static_cast<uint32>(t);
+            k = static_cast<int64>(p >> 32) - (t >> 32);
+        }
+        t = static_cast<int64>(un[j + n]) - k;
+        un[j + n] = static_cast<uint32>(t);
+        q[j] = static_cast<uint32>(qhat);
+        if (t < 0) {
+            q[j]--;
+            uint64 c = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64 sum = static_cast<uint64>(un[i + j]) + vn[i] + c;
+                un[i + j] = static_cast<uint32>(sum);
+                c = sum >> 32;
+            }
+            un[j + n] = static_cast<uint32>(un[j + n] + c);
+        }
+    }
+    r.assign(n, 0);
+    for (size_t i = 0; i < n; ++i)
+        r[i] = (un[i] >> s) | (s ? static_cast<uint32>(static_cast<uint64>(un[i + 1]) << (32 - s)) : 0);
+    trim(q);
+    trim(r);
+}
+
+// round(num / den), half away from zero, on magnitudes.
+Mag divRound(const Mag &num, const Mag &den)
+{
+    Mag q, r;
+    divMag(num, den, q, r);
+    Mag twice = addMag(r, r);
+    if (cmpMag(twice, den) >= 0) {
+        q = addMag(q, Mag(1, 1));
+    }
+    return q;
+}
+
+// Multiply (e > 0) or divide with rounding (e < 0) by 10^|e|.
+Mag rescale(const Mag &m, int32 e)
+{
+    if (e == 0) return m;
+    if (e > 0) return mulMag(m, pow10Mag(e));
+    return divRound(m, pow10Mag(-e));
+}
+
+void checkPrecision(const Mag &m, int32 precision)
+{
+    if (cmpMag(m, pow10Mag(precision)) >= 0) {
+        vt_report_error(0, "numeric value out of range for NUMERIC(%d)", precision);
+    }
+}
+
+void store(VNumeric *out, Big b)
+{
+    trim(b.mag);
+    if (b.mag.empty()) b.neg = false;
+    checkPrecision(b.mag, out->getPrecision());
+    toWords(b, out->words, out->nwds);
+}
+
+} // namespace
+
+/*---------------------------------------------------------------------------
+ * VNumeric
+ *-------------------------------------------------------------------------*/
+
+VNumeric::VNumeric(uint64 *words, int32 typmod)
+    : words(words),
+      nwds(getNumericWordCount(getPrecision(typmod))),
+      typmod(typmod)
+{
+}
+
+VNumeric::VNumeric(uint64 *words, int32 precision, int32 scale)
+    : words(words),
+      nwds(getNumericWordCount(precision)),
+      typmod(computeTypmod(precision, scale))
+{
+}
+
+bool VNumeric::isNull() const
+{
+    if (words[0] != 0x8000000000000000ULL) return false;
+    for (int32 i = 1; i < nwds; ++i) {
+        if (words[i] != 0) return false;
+    }
+    return true;
+}
+
+void VNumeric::setNull()
+{
+    words[0] = 0x8000000000000000ULL;
+    for (int32 i = 1; i < nwds; ++i) words[i] = 0;
+}
+
+bool VNumeric::isZero() const
+{
+    for (int32 i = 0; i < nwds; ++i) {
+        if (words[i] != 0) return false;
+    }
+    return true;
+}
+
+void VNumeric::setZero()
+{
+    for (int32 i = 0; i < nwds; ++i) words[i] = 0;
+}
+
+void VNumeric::negate()
+{
+    uint64 carry = 1;
+    for (int32 i = nwds - 1; i >= 0; --i) {
+        words[i] = ~words[i] + carry;
+        carry = (carry && words[i] == 0) ? 1 : 0;
+    }
+}
+
+void VNumeric::copy(const VNumeric *from)
+{
+    Big b = fromWords(from->words, from->nwds);
+    b.mag = rescale(b.mag, getScale() - from->getScale());
+    store(this, b);
+}
+
+void VNumeric::copy(vint value)
+{
+    Big b;
+    b.neg = value < 0;
+    uint64 m = b.neg ? ~static_cast<uint64>(value) + 1 : static_cast<uint64>(value);
+    b.mag.push_back(static_cast<uint32>(m));
+    b.mag.push_back(static_cast<uint32>(m >> 32));
+    trim(b.mag);
+    b.mag = rescale(b.mag, getScale());
+    store(this, b);
+}
+
+void VNumeric::accumulate(const VNumeric *from)
+{
+    const int32 shift = nwds - from->nwds;
+    const uint64 ext = static_cast<int64>(from->words[0]) < 0 ? ~0ULL : 0ULL;
+    unsigned char carry = 0;
+    for (int32 i = nwds - 1; i >= 0; --i) {
+        int32 j = i - shift;
+        uint64 b = (j >= 0 && j < from->nwds) ? from->words[j] : ext;
+        uint64 s = words[i] + b;
+        unsigned char c1 = s < b;
+        uint64 s2 = s + carry;
+        unsigned char c2 = s2 < s;
+        words[i] = s2;
+        carry = c1 | c2;
+    }
+}
+
+void VNumeric::add(const VNumeric *a, const VNumeric *b)
+{
+    Big x = fromWords(a->words, a->nwds);
+    Big y = fromWords(b->words, b->nwds);
+    x.mag = rescale(x.mag, getScale() - a->getScale());
+    y.mag = rescale(y.mag, getScale() - b->getScale());
+    Big r;
+    if (x.neg == y.neg) {
+        r.neg = x.neg;
+        r.mag = addMag(x.mag, y.mag);
+    } else if (cmpMag(x.mag, y.mag) >= 0) {
+        r.neg = x.neg;
+        r.mag = subMag(x.mag, y.mag);
+    } else {
+        r.neg = y.neg;
+        r.mag = subMag(y.mag, x.mag);
+    }
+    store(this, r);
+}
+
+void VNumeric::sub(const VNumeric *a, const VNumeric *b)
+{
+    std::vector<uint64> t(b->words, b->words + b->nwds);
+    VNumeric nb(&t[0], b->typmod);
+    nb.negate();
+    add(a, &nb);
+}
+
+void VNumeric::mul(const VNumeric *a, const VNumeric *b)
+{
+    Big x = fromWords(a->words, a->nwds);
+    Big y = fromWords(b->words, b->nwds);
+    Big r;
+    r.neg = x.neg != y.neg;
+    r.mag = rescale(mulMag(x.mag, y.mag),
+                    getScale() - a->getScale() - b->getScale());
+    store(this, r);
+}
+
+void VNumeric::div(const VNumeric *a, const VNumeric *b)
+{
+    Big x = fromWords(a->words, a->nwds);
+    Big y = fromWords(b->words, b->nwds);
+    if (y.mag.empty()) {
+        vt_report_error(0, "division by zero");
+    }
+    int32 e = getScale() - a->getScale() + b->getScale();
+    Mag num = e >= 0 ? rescale(x.mag, e) : x.mag;
+    Mag den = e < 0 ? rescale(y.mag, -e) : y.mag;
+    Big r;
+    r.neg = x.neg != y.neg;
+    r.mag = divRound(num, den);
+    store(this, r);
+}
+
+int VNumeric::compare(const VNumeric *other) const
+{
+    Big x = fromWords(words, nwds);
+    Big y = fromWords(other->words, other->nwds);
+    int32 e = getScale() - other->getScale();
+    if (e > 0) y.mag = rescale(y.mag, e);
+    if (e < 0) x.mag = rescale(x.mag, -e);
+    if (x.neg != y.neg) return x.neg ? -1 : 1;
+    int c = cmpMag(x.mag, y.mag);
+    return x.neg ? -c : c;
+}
+
+std::string VNumeric::toString() const
+{
+    if (isNull()) return "NULL";
+    Big b = fromWords(words, nwds);
+    std::string digits;
+    Mag m = b.mag;
+    while (!m.empty()) {
+        uint64 rem = 0;
+        for (size_t i = m.size(); i-- > 0;) {
+            uint64 cur = (rem << 32) | m[i];
+            m[i] = static_cast<uint32>(cur / 1000000000ULL);
+            rem = cur % 1000000000ULL;
+        }
+        trim(m);
+        char chunk[16];
+        snprintf(chunk, sizeof(chunk), m.empty() ? "%llu" : "%09llu",
+                 static_cast<unsigned long long>(rem));
+        digits = std::string(chunk) + digits;
+    }
+    int32 scale = getScale();
+    if (static_cast<int32>(digits.size()) <= scale) {
+        digits = std::string(scale + 1 - digits.size(), '0') + digits;
+    }
+    if (scale > 0) {
+        digits.insert(digits.size() - scale, ".");
+    }
+    return (b.neg ? "-" : "") + digits;
+}
+
+void VNumeric::toString(char *outBuf, size_t olen) const
+{
+    std::string s = toString();
+    snprintf(outBuf, olen, "%s", s.c_str());
+}
+
+vfloat VNumeric::toFloat() const
+{
+    return strtod(toString().c_str(), 0);
+}
+
+/*---------------------------------------------------------------------------
+ * VString, types and rows
+ *-------------------------------------------------------------------------*/
+
+void VString::copy(const char *s, vsize l)
+{
+    if (l > cap) {
+        vt_report_error(0, "value of length %u exceeds VARBINARY/VARCHAR(%u)",
+                        static_cast<unsigned>(l), static_cast<unsigned>(cap));
+    }
+    memmove(buf, s, l);
+    *len = l;
+}
+
+size_t VerticaType::getMockSlotSize() const
+{
+    switch (kind) {
+    case MockNumeric:
+        return static_cast<size_t>(getNumericLength());
+    case MockVarchar:
+    case MockVarbinary:
+    case MockLongVarbinary:
+        return 8 + ((static_cast<size_t>(maxSize) + 7) & ~static_cast<size_t>(7));
+    default:
+        return 8;
+    }
+}
+
+void MockRow::bindLayout(const SizedColumnTypes &t)
+{
+    types = t;
+    offsets.clear();
+    rowSize = 0;
+    for (size_t i = 0; i < t.getColumnCount(); ++i) {
+        offsets.push_back(rowSize);
+        rowSize += t.getColumnType(i).getMockSlotSize();
+    }
+    numerics.assign(t.getColumnCount(), VNumeric(0, VNumeric::computeTypmod(1, 0)));
+    strings.assign(t.getColumnCount(), VString());
+}
+
+VNumeric &MockRow::getNumericRef(size_t col)
+{
+    VNumeric &n = numerics[col];
+    n.words = reinterpret_cast<uint64 *>(at(col));
+    n.typmod = types.getColumnType(col).getTypeMod();
+    n.nwds = VNumeric::getNumericWordCount(n.getPrecision());
+    return n;
+}
+
+VString &MockRow::getStringRef(size_t col)
+{
+    VString &s = strings[col];
+    s.len = reinterpret_cast<vsize *>(at(col));
+    s.cap = static_cast<vsize>(types.getColumnType(col).getStringLength());
+    s.buf = at(col) + sizeof(vsize);
+    return s;
+}
+
+bool BlockReader::isNull(size_t col)
+{
+    const VerticaType &t = types.getColumnType(col);
+    if (t.isNumeric()) return getNumericRef(col).isNull();
+    if (t.isFloat()) return std::isnan(getFloatRef(col));
+    if (t.isBool()) return getBoolRef(col) == vbool_null;
+    if (t.isVarchar() || t.isVarbinary() || t.isLongVarbinary()) return getStringRef(col).isNull();
+    return getIntRef(col) == vint_null;
+}
+
+void BlockWriter::setNull(size_t col)
+{
+    const VerticaType &t = types.getColumnType(col);
+    if (t.isNumeric()) getNumericRef(col).setNull();
+    else if (t.isFloat()) getFloatRef(col) = NAN;
+    else if (t.isBool()) getBoolRef(col) = vbool_null;
+    else if (t.isVarchar() || t.isVarbinary() || t.isLongVarbinary()) getStringRef(col).setNull();
+    else getIntRef(col) = vint_null;
+}
+
+/*---------------------------------------------------------------------------
+ * ParamReader
+ *-------------------------------------------------------------------------*/
+
+const vint &ParamReader::getIntRef(const std::string &name) const
+{
+    std::map<std::string, vint>::const_iterator it = ints.find(name);
+    if (it == ints.end()) vt_report_error(0, "parameter %s not found", name.c_str());
+    return it->second;
+}
+
+const vbool &ParamReader::getBoolRef(const std::string &name) const
+{
+    std::map<std::string, vbool>::const_iterator it = bools.find(name);
+    if (it == bools.end()) vt_report_error(0, "parameter %s not found", name.c_str());
+    return it->second;
+}
+
+std::string ParamReader::getStringRef(const std::string &name) const
+{
+    std::map<std::string, std::string>::const_iterator it = strings.find(name);
+    if (it == strings.end()) vt_report_error(0, "parameter %s not found", name.c_str());
+    return it->second;
+}
+
+} // namespace Vertica
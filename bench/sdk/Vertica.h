@@ -0,0 +1,608 @@
+/*
+ * Minimal offline stand-in for the Vertica C++ UDx SDK header.
+ *
+ * Only the surface that the exact_avg library touches is modelled, with the
+ * same names and signatures as /opt/vertica/sdk/include/Vertica.h so that the
+ * UDx sources compile unchanged against either header.  Semantics follow the
+ * real SDK where they matter for correctness:
+ *
+ *  - NUMERIC values are two's-complement integers scaled by 10^scale, stored
+ *    in getNumericWordCount(p) = p/19 + 1 64-bit words, most significant word
+ *    first (words[0] carries the sign).
+ *  - NULL NUMERIC is the most negative value (0x8000.. followed by zeros);
+ *    NULL INTEGER is vint_null.
+ *  - vt_report_error() throws, aborting the current UDx call.
+ *
+ * Nothing here talks to a server: blocks, intermediates and writers are plain
+ * memory that the benchmark harness lays out itself.
+ */
+#ifndef VERTICA_MOCK_SDK_H
+#define VERTICA_MOCK_SDK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef int8_t   int8;
+typedef uint8_t  uint8;
+typedef int16_t  int16;
+typedef uint16_t uint16;
+typedef int32_t  int32;
+typedef uint32_t uint32;
+typedef int64_t  int64;
+typedef uint64_t uint64;
+
+typedef int64    vint;
+typedef double   vfloat;
+typedef uint8    vbool;
+typedef int64    vpos;
+typedef uint32   vsize;
+typedef int64    Interval;
+typedef int64    Timestamp;
+typedef int64    TimestampTz;
+typedef long double ifloat;
+
+const vint  vint_null  = static_cast<vint>(0x8000000000000000ULL);
+// FLOAT NULL is one particular NaN bit pattern, distinct from the NaN value.
+const uint64 vfloat_null_bits = 0x7FF0000000000001ULL;
+inline bool vfloatIsNull(vfloat v)
+{
+    uint64 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits == vfloat_null_bits;
+}
+
+inline vfloat vfloatNull()
+{
+    vfloat v;
+    memcpy(&v, &vfloat_null_bits, sizeof(v));
+    return v;
+}
+const vfloat vfloat_null = vfloatNull();
+const vbool vbool_null = 2;
+const vbool vbool_true = 1;
+const vbool vbool_false = 0;
+
+namespace Vertica
+{
+
+/*---------------------------------------------------------------------------
+ * Errors
+ *-------------------------------------------------------------------------*/
+
+class UDXException : public std::runtime_error
+{
+public:
+    UDXException(int errcode, const std::string &msg)
+        : std::runtime_error(msg), errcode(errcode) {}
+    int errcode;
+};
+
+std::string vt_format(const char *fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+#define vt_report_error(errcode, ...) \
+    throw ::Vertica::UDXException((errcode), ::Vertica::vt_format(__VA_ARGS__))
+
+/*---------------------------------------------------------------------------
+ * Memory
+ *-------------------------------------------------------------------------*/
+
+/**
+ * Per-query arena.  The real allocator frees everything when the query ends;
+ * the mock frees everything when the allocator is destroyed.
+ */
+class VTAllocator
+{
+public:
+    VTAllocator() {}
+    ~VTAllocator();
+    void *alloc(size_t size);
+    size_t getBytesAllocated() const { return bytes; }
+
+private:
+    VTAllocator(const VTAllocator &);
+    VTAllocator &operator=(const VTAllocator &);
+    std::vector<void *> chunks;
+    size_t bytes = 0;
+};
+
+template <class T, class... Args>
+T *vt_createFuncObject(VTAllocator *allocator, Args... args)
+{
+    return new (allocator->alloc(sizeof(T))) T(args...);
+}
+
+/*---------------------------------------------------------------------------
+ * NUMERIC
+ *-------------------------------------------------------------------------*/
+
+struct VNumeric
+{
+    uint64 *words;
+    int32 nwds;
+    int32 typmod;
+
+    VNumeric(uint64 *words, int32 typmod);
+    VNumeric(uint64 *words, int32 precision, int32 scale);
+
+    static int32 computeTypmod(int32 precision, int32 scale)
+    { return ((precision << 16) | scale) + 4; }
+    static int32 getPrecision(int32 typmod) { return ((typmod - 4) >> 16) & 0xffff; }
+    static int32 getScale(int32 typmod) { return (typmod - 4) & 0xffff; }
+    static int32 getNumericWordCount(int32 precision) { return precision / 19 + 1; }
+
+    int32 getPrecision() const { return getPrecision(typmod); }
+    int32 getScale() const { return getScale(typmod); }
+
+    bool isNull() const;
+    void setNull();
+    bool isZero() const;
+    void setZero();
+    bool isNeg() const { return static_cast<int64>(words[0]) < 0; }
+    void negate();
+
+    /** this = from, rescaled to this->getScale() (rounding half away from zero). */
+    void copy(const VNumeric *from);
+    /** this = value (an integer), scaled by 10^getScale(). */
+    void copy(vint value);
+
+    /** this += from.  Both operands must have the same scale. */
+    void accumulate(const VNumeric *from);
+    void add(const VNumeric *a, const VNumeric *b);
+    void sub(const VNumeric *a, const VNumeric *b);
+    /** this = a * b, rescaled to this->getScale(). */
+    void mul(const VNumeric *a, const VNumeric *b);
+    /** this = a / b, rounded half away from zero at this->getScale(). */
+    void div(const VNumeric *a, const VNumeric *b);
+
+    int compare(const VNumeric *other) const;
+    bool equal(const VNumeric *other) const { return compare(other) == 0; }
+
+    vfloat toFloat() const;
+    void toString(char *outBuf, size_t olen) const;
+    std::string toString() const;
+};
+
+/*---------------------------------------------------------------------------
+ * Strings (VARCHAR / VARBINARY payloads)
+ *-------------------------------------------------------------------------*/
+
+/**
+ * The real VString is a view onto an EE-owned buffer with a length header.
+ * The mock lays out [vsize length][capacity bytes] in caller-owned memory,
+ * with no padding, so the bytes are only 4-byte aligned: nothing promises
+ * more, and code that reads them as wider words should fail under UBSan.
+ */
+struct VString
+{
+    VString() : len(0), cap(0), buf(0) {}
+    VString(vsize *len, vsize cap, char *buf) : len(len), cap(cap), buf(buf) {}
+
+    bool isNull() const { return *len == static_cast<vsize>(-1); }
+    void setNull() { *len = static_cast<vsize>(-1); }
+    vsize length() const { return isNull() ? 0 : *len; }
+    vsize capacity() const { return cap; }
+    const char *data() const { return buf; }
+    char *data() { return buf; }
+    std::string str() const { return std::string(buf, length()); }
+
+    void copy(const char *s, vsize l);
+    void copy(const VString *from) { copy(from->data(), from->length()); }
+    void copy(const std::string &s) { copy(s.data(), static_cast<vsize>(s.size())); }
+
+    vsize *len;
+    vsize cap;
+    char *buf;
+};
+
+/*---------------------------------------------------------------------------
+ * Types
+ *-------------------------------------------------------------------------*/
+
+enum MockTypeKind
+{
+    MockInt, MockFloat, MockNumeric, MockBool, MockVarchar, MockVarbinary,
+    MockLongVarbinary, MockInterval, MockIntervalYM, MockTimestamp, MockTimestampTz, MockAny
+};
+
+class VerticaType
+{
+public:
+    VerticaType() : kind(MockAny), typmod(-1), maxSize(0) {}
+    VerticaType(MockTypeKind kind, int32 typmod, int32 maxSize = 0)
+        : kind(kind), typmod(typmod), maxSize(maxSize) {}
+
+    MockTypeKind getKind() const { return kind; }
+    int32 getTypeMod() const { return typmod; }
+
+    bool isInt() const { return kind == MockInt; }
+    bool isFloat() const { return kind == MockFloat; }
+    bool isNumeric() const { return kind == MockNumeric; }
+    bool isBool() const { return kind == MockBool; }
+    bool isVarchar() const { return kind == MockVarchar; }
+    bool isVarbinary() const { return kind == MockVarbinary; }
+    bool isLongVarbinary() const { return kind == MockLongVarbinary; }
+    bool isInterval() const { return kind == MockInterval; }
+    bool isIntervalYM() const { return kind == MockIntervalYM; }
+    bool isTimestamp() const { return kind == MockTimestamp; }
+    bool isTimestampTz() const { return kind == MockTimestampTz; }
+
+    int32 getNumericPrecision() const { return VNumeric::getPrecision(typmod); }
+    int32 getIntervalPrecision() const { return typmod < 0 ? -1 : (typmod & 0xffff); }
+    int32 getTimestampPrecision() const { return typmod; }
+    int32 getNumericScale() const { return VNumeric::getScale(typmod); }
+    int32 getNumericWordCount() const
+    { return VNumeric::getNumericWordCount(getNumericPrecision()); }
+    int32 getNumericLength() const { return getNumericWordCount() * 8; }
+    int32 getStringLength() const { return maxSize; }
+
+    /** Bytes one value of this type occupies in a mock block or tuple. */
+    size_t getMockSlotSize() const;
+
+private:
+    MockTypeKind kind;
+    int32 typmod;
+    int32 maxSize;
+};
+
+/** Argument/return types as declared in getPrototype(). */
+class ColumnTypes
+{
+public:
+    void addInt() { kinds.push_back(MockInt); }
+    void addFloat() { kinds.push_back(MockFloat); }
+    void addNumeric() { kinds.push_back(MockNumeric); }
+    void addBool() { kinds.push_back(MockBool); }
+    void addVarchar() { kinds.push_back(MockVarchar); }
+    void addVarbinary() { kinds.push_back(MockVarbinary); }
+    void addLongVarbinary() { kinds.push_back(MockLongVarbinary); }
+    void addInterval() { kinds.push_back(MockInterval); }
+    void addIntervalYM() { kinds.push_back(MockIntervalYM); }
+    void addTimestamp() { kinds.push_back(MockTimestamp); }
+    void addTimestampTz() { kinds.push_back(MockTimestampTz); }
+    void addAny() { kinds.push_back(MockAny); }
+
+    size_t getColumnCount() const { return kinds.size(); }
+    MockTypeKind getColumnKind(size_t i) const { return kinds[i]; }
+
+private:
+    std::vector<MockTypeKind> kinds;
+};
+
+/** Fully sized column types (precision, scale, lengths) with names. */
+class SizedColumnTypes
+{
+public:
+    void addInt(const std::string &name = "") { add(VerticaType(MockInt, -1), name); }
+    void addFloat(const std::string &name = "") { add(VerticaType(MockFloat, -1), name); }
+    void addBool(const std::string &name = "") { add(VerticaType(MockBool, -1), name); }
+    void addNumeric(int32 precision, int32 scale, const std::string &name = "")
+    { add(VerticaType(MockNumeric, VNumeric::computeTypmod(precision, scale)), name); }
+    void addVarchar(int32 len, const std::string &name = "")
+    { add(VerticaType(MockVarchar, -1, len), name); }
+    void addVarbinary(int32 len, const std::string &name = "")
+    { add(VerticaType(MockVarbinary, -1, len), name); }
+    void addLongVarbinary(int32 len, const std::string &name = "")
+    { add(VerticaType(MockLongVarbinary, -1, len), name); }
+    void addInterval(int32 precision, int32 range, const std::string &name = "")
+    { add(VerticaType(MockInterval, (range << 16) | precision), name); }
+    void addTimestamp(int32 precision, const std::string &name = "")
+    { add(VerticaType(MockTimestamp, precision), name); }
+    void addTimestampTz(int32 precision, const std::string &name = "")
+    { add(VerticaType(MockTimestampTz, precision), name); }
+    void addArg(const VerticaType &type, const std::string &name = "") { add(type, name); }
+
+    size_t getColumnCount() const { return types.size(); }
+    const VerticaType &getColumnType(size_t i) const { return types.at(i); }
+    const std::string &getColumnName(size_t i) const { return names.at(i); }
+
+    /** Argument columns of a transform/analytic call (the mock has no PARTITION/ORDER columns). */
+    void getArgumentColumns(std::vector<size_t> &cols) const
+    {
+        cols.clear();
+        for (size_t i = 0; i < types.size(); ++i) cols.push_back(i);
+    }
+
+private:
+    void add(const VerticaType &t, const std::string &name)
+    { types.push_back(t); names.push_back(name); }
+
+    std::vector<VerticaType> types;
+    std::vector<std::string> names;
+};
+
+/*---------------------------------------------------------------------------
+ * Parameters and server interface
+ *-------------------------------------------------------------------------*/
+
+class ParamReader
+{
+public:
+    bool containsParameter(const std::string &name) const
+    { return ints.count(name) || bools.count(name) || strings.count(name); }
+    const vint &getIntRef(const std::string &name) const;
+    const vbool &getBoolRef(const std::string &name) const;
+    std::string getStringRef(const std::string &name) const;
+
+    void setInt(const std::string &name, vint v) { ints[name] = v; }
+    void setBool(const std::string &name, bool v) { bools[name] = v ? vbool_true : vbool_false; }
+    void setString(const std::string &name, const std::string &v) { strings[name] = v; }
+    void clear() { ints.clear(); bools.clear(); strings.clear(); }
+
+private:
+    std::map<std::string, vint> ints;
+    std::map<std::string, vbool> bools;
+    std::map<std::string, std::string> strings;
+};
+
+class ServerInterface
+{
+public:
+    ServerInterface() : allocator(&arena) {}
+
+    ParamReader &getParamReader() { return params; }
+    void log(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    VTAllocator *allocator;
+
+private:
+    ServerInterface(const ServerInterface &);
+    ServerInterface &operator=(const ServerInterface &);
+    VTAllocator arena;
+    ParamReader params;
+};
+
+/*---------------------------------------------------------------------------
+ * Row access
+ *-------------------------------------------------------------------------*/
+
+/**
+ * Common base for everything that hands out typed references into a row of
+ * mock memory.  Column i of the current row lives at base + offsets[i].
+ */
+class MockRow
+{
+public:
+    MockRow() : base(0) {}
+    virtual ~MockRow() {}
+
+    const SizedColumnTypes &getTypeMetaData() const { return types; }
+
+    vint &getIntRef(size_t col) { return *reinterpret_cast<vint *>(at(col)); }
+    vfloat &getFloatRef(size_t col) { return *reinterpret_cast<vfloat *>(at(col)); }
+    vbool &getBoolRef(size_t col) { return *reinterpret_cast<vbool *>(at(col)); }
+    Interval &getIntervalRef(size_t col) { return *reinterpret_cast<Interval *>(at(col)); }
+    Timestamp &getTimestampRef(size_t col) { return *reinterpret_cast<Timestamp *>(at(col)); }
+    TimestampTz &getTimestampTzRef(size_t col) { return *reinterpret_cast<TimestampTz *>(at(col)); }
+    VNumeric &getNumericRef(size_t col);
+    VString &getStringRef(size_t col);
+
+    /** Mock plumbing: bind this row view to a layout and a memory address. */
+    void bindLayout(const SizedColumnTypes &t);
+    void bindBase(char *p) { base = p; }
+    char *getBase() const { return base; }
+    size_t getRowSize() const { return rowSize; }
+    const std::vector<size_t> &getOffsets() const { return offsets; }
+
+protected:
+    char *at(size_t col) { return base + offsets[col]; }
+
+    SizedColumnTypes types;
+    std::vector<size_t> offsets;
+    std::vector<VNumeric> numerics;
+    std::vector<VString> strings;
+    size_t rowSize = 0;
+    char *base;
+};
+
+/** Reads a block of input rows; rows are contiguous, rowSize bytes apart. */
+class BlockReader : public MockRow
+{
+public:
+    bool next()
+    {
+        if (++row >= numRows) return false;
+        base += rowSize;
+        return true;
+    }
+    size_t getNumRows() const { return numRows; }
+    bool isNull(size_t col);
+
+    void bindBlock(char *p, size_t rows) { base = p; numRows = rows; row = 0; }
+
+private:
+    size_t numRows = 0;
+    size_t row = 0;
+};
+
+/** Writes result rows, one after another. */
+class BlockWriter : public MockRow
+{
+public:
+    void setInt(size_t col, vint v) { getIntRef(col) = v; }
+    void setFloat(size_t col, vfloat v) { getFloatRef(col) = v; }
+    void setInterval(size_t col, Interval v) { getIntervalRef(col) = v; }
+    void setTimestamp(size_t col, Timestamp v) { getTimestampRef(col) = v; }
+    void setTimestampTz(size_t col, TimestampTz v) { getTimestampTzRef(col) = v; }
+    void setNull(size_t col);
+    void next() { base += rowSize; ++rows; }
+    size_t getRowsWritten() const { return rows; }
+
+private:
+    size_t rows = 0;
+};
+
+/** One group's intermediate aggregate tuple. */
+class IntermediateAggs : public MockRow {};
+
+/** Several partial tuples for the same group, consumed by combine(). */
+class MultipleIntermediateAggs : public MockRow
+{
+public:
+    bool next()
+    {
+        if (++row >= numRows) return false;
+        base += rowSize;
+        return true;
+    }
+    void bindBlock(char *p, size_t rows) { base = p; numRows = rows; row = 0; }
+
+private:
+    size_t numRows = 0;
+    size_t row = 0;
+};
+
+/*---------------------------------------------------------------------------
+ * UDx base classes
+ *-------------------------------------------------------------------------*/
+
+class UDXObject
+{
+public:
+    virtual ~UDXObject() {}
+    virtual void setup(ServerInterface &srvInterface, const SizedColumnTypes &argTypes) {}
+    virtual void destroy(ServerInterface &srvInterface, const SizedColumnTypes &argTypes) {}
+};
+
+class AggregateFunction : public UDXObject
+{
+public:
+    virtual void initAggregate(ServerInterface &srvInterface, IntermediateAggs &aggs) = 0;
+    virtual void aggregate(ServerInterface &srvInterface, BlockReader &argReader,
+                           IntermediateAggs &aggs) = 0;
+    virtual void combine(ServerInterface &srvInterface, IntermediateAggs &aggs,
+                         MultipleIntermediateAggs &aggsOther) = 0;
+    virtual void terminate(ServerInterface &srvInterface, BlockWriter &resWriter,
+                           IntermediateAggs &aggs) = 0;
+
+    /**
+     * GROUP BY entry point.  For each of the count groups, dstTuples[i] + doff
+     * is that group's intermediate tuple and arr + i*stride holds a pointer to
+     * the group's run of input rows; rcounts + i*rcstride holds the run length
+     * as a vpos.
+     */
+    virtual void aggregateArrs(ServerInterface &srvInterface, void **dstTuples,
+                               int doff, const void *arr, int stride,
+                               const void *rcounts, int rcstride, int count,
+                               IntermediateAggs &intAggs, std::vector<int> &intOffsets,
+                               BlockReader &arg_reader) = 0;
+
+protected:
+    /** Re-point arg_reader and intAggs at one group's rows and tuple. */
+    void updateCols(BlockReader &arg_reader, char *arg, int count,
+                    IntermediateAggs &intAggs, char *aggPtr,
+                    std::vector<int> &intOffsets)
+    {
+        arg_reader.bindBlock(*reinterpret_cast<char **>(arg), static_cast<size_t>(count));
+        intAggs.bindBase(aggPtr);
+    }
+};
+
+#define InlineAggregate()                                                     \
+    virtual void aggregateArrs(ServerInterface &srvInterface, void **dstTuples, \
+                               int doff, const void *arr, int stride,         \
+                               const void *rcounts, int rcstride, int count,  \
+                               IntermediateAggs &intAggs,                     \
+                               std::vector<int> &intOffsets,                  \
+                               BlockReader &arg_reader)                       \
+    {                                                                         \
+        char *arg = const_cast<char *>(static_cast<const char *>(arr));       \
+        const uint8 *rowCountPtr = static_cast<const uint8 *>(rcounts);       \
+        for (int i = 0; i < count; ++i) {                                     \
+            vpos rowCount = *reinterpret_cast<const vpos *>(rowCountPtr);     \
+            char *aggPtr = static_cast<char *>(dstTuples[i]) + doff;          \
+            updateCols(arg_reader, arg, static_cast<int>(rowCount), intAggs,  \
+                       aggPtr, intOffsets);                                   \
+            aggregate(srvInterface, arg_reader, intAggs);                     \
+            rowCountPtr += rcstride;                                          \
+            arg += stride;                                                    \
+        }                                                                     \
+    }
+
+class UDXFactory
+{
+public:
+    virtual ~UDXFactory() {}
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes, ColumnTypes &returnType) = 0;
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &argTypes,
+                               SizedColumnTypes &returnType) = 0;
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes) {}
+};
+
+class AggregateFunctionFactory : public UDXFactory
+{
+public:
+    virtual void getIntermediateTypes(ServerInterface &srvInterface,
+                                      const SizedColumnTypes &inputTypes,
+                                      SizedColumnTypes &intermediateTypeMetaData) = 0;
+    virtual AggregateFunction *createAggregateFunction(ServerInterface &srvInterface) = 0;
+};
+
+/** One partition's rows, in ORDER BY order, read front to back. */
+class AnalyticPartitionReader : public BlockReader {};
+
+/** One output row per input row of the partition. */
+class AnalyticPartitionWriter : public BlockWriter {};
+
+class AnalyticFunction : public UDXObject
+{
+public:
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  AnalyticPartitionReader &inputReader,
+                                  AnalyticPartitionWriter &outputWriter) = 0;
+};
+
+class AnalyticFunctionFactory : public UDXFactory
+{
+public:
+    virtual AnalyticFunction *createAnalyticFunction(ServerInterface &srvInterface) = 0;
+};
+
+/** One partition's rows, read front to back. */
+class PartitionReader : public BlockReader {};
+
+/** Any number of output rows for the partition. */
+class PartitionWriter : public BlockWriter {};
+
+class TransformFunction : public UDXObject
+{
+public:
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  PartitionReader &inputReader,
+                                  PartitionWriter &outputWriter) = 0;
+};
+
+class TransformFunctionFactory : public UDXFactory
+{
+public:
+    virtual TransformFunction *createTransformFunction(ServerInterface &srvInterface) = 0;
+};
+
+/*---------------------------------------------------------------------------
+ * Factory registration
+ *-------------------------------------------------------------------------*/
+
+/** Name -> factory map filled by RegisterFactory() at static-init time. */
+std::map<std::string, UDXFactory *> &mockFactoryRegistry();
+
+struct MockFactoryRegistrar
+{
+    MockFactoryRegistrar(const char *name, UDXFactory *factory)
+    { mockFactoryRegistry()[name] = factory; }
+};
+
+#define RegisterFactory(FACTORY)                                              \
+    static ::Vertica::MockFactoryRegistrar FACTORY##_mock_registrar(          \
+        #FACTORY, new FACTORY)
+
+} // namespace Vertica
+
+#endif // VERTICA_MOCK_SDK_H
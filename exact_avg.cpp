@@ -1,279 +1,4475 @@
 #include "Vertica.h"
-#include <vector>
+#include <cmath>
+#include <cstring>
 #include <exception>
+#include <limits>
+#include <sstream>
 
 using namespace Vertica;
 
 // Maximum precision Vertica allows for NUMERIC; used as an absolute ceiling.
 static const int32 MAX_NUMERIC_PRECISION = 1024;
 
+// Largest NUMERIC precision stored in a single 64-bit word. Inputs up to this
+// precision have a two-word (p_sum <= 37) intermediate SUM, so a whole block
+// can be summed in a native __int128.
+static const int32 MAX_INT128_LANE_PRECISION = 18;
+
+// Number of 64-bit words in a NUMERIC(1024) value (p / 19 + 1).
+static const int32 MAX_NUMERIC_WORDS = MAX_NUMERIC_PRECISION / 19 + 1;
+
+// Inputs this wide (NUMERIC(57) and up) are summed sign-magnitude, touching
+// only each value's significant words; narrower ones are cheaper to sum at
+// full width.
+static const int32 SIGN_MAGNITUDE_MIN_WORDS = 4;
+
+// Sign-magnitude blocks shorter than this (typically a GROUP BY run handed
+// to aggregateArrs()) are added row by row with DirectBlock rather than
+// through two lane sets that would be cleared and flushed for a few rows.
+// CarrySaveBlock's single lane set stays cheaper even for short runs.
+static const int32 SHORT_BLOCK_ROWS = 16;
+
+// RunLengthBlock keeps going past the first RUN_PROBE_ROWS non-NULL rows of
+// a block only if their runs of equal values average MIN_RUN_LENGTH rows.
+// Below that the per-row compare and per-run multiply cost more than they
+// save.
+static const vint RUN_PROBE_ROWS = 32;
+static const vint MIN_RUN_LENGTH = 4;
+
+// Digits of an INTEGER input (|v| <= 9.2e18), which is summed and divided
+// as if it were NUMERIC(19, 0).
+static const int32 INTEGER_PRECISION = 19;
+
+// Extra SUM digits that cover any 64-bit row count (N <= 9.2e18, 19 digits).
+static const int32 ROW_COUNT_DIGITS = 19;
+
+// Largest possible row count; the default for the max_rows parameter.
+static const vint MAX_ROW_COUNT = 0x7FFFFFFFFFFFFFFFLL;
+
+// Words in the widest SUM: a NUMERIC(1024) input plus 19 row-count digits,
+// sized like a NUMERIC(1043) would be (p / 19 + 1).
+static const int32 MAX_SUM_WORDS =
+    (MAX_NUMERIC_PRECISION + ROW_COUNT_DIGITS) / 19 + 1;
+
+// Digits the result gains over the input: p_out = min(1024, p_in + 5),
+// s_out = s_in + (p_out - p_in).
+static const int32 AVG_EXTRA_DIGITS = 5;
+
+// The input types held as one int64 per value and summed by the INTEGER
+// path: INTEGER itself, and INTERVAL (DAY TO SECOND), TIMESTAMP and
+// TIMESTAMPTZ as microseconds. All but INTEGER average to their own type.
+enum Int64Input
+{
+    NOT_INT64_INPUT,
+    INTEGER_INPUT,
+    INTERVAL_INPUT,
+    TIMESTAMP_INPUT,
+    TIMESTAMPTZ_INPUT
+};
+
+static Int64Input int64InputOf(const VerticaType &inType)
+{
+    if (inType.isInt()) {
+        return INTEGER_INPUT;
+    }
+    if (inType.isInterval()) {
+        return INTERVAL_INPUT;
+    }
+    if (inType.isTimestamp()) {
+        return TIMESTAMP_INPUT;
+    }
+    if (inType.isTimestampTz()) {
+        return TIMESTAMPTZ_INPUT;
+    }
+    return NOT_INT64_INPUT;
+}
+
+// Microseconds in one unit of the argument's last declared digit: 10^(6 - p)
+// for TIMESTAMP(p), TIMESTAMPTZ(p) and INTERVAL ... SECOND(p), 1 for INTEGER
+// and when the type carries no precision (p = 6).
+static vint int64InputUnit(const VerticaType &inType, Int64Input int64Input)
+{
+    int32 precision = -1;
+    if (int64Input == INTERVAL_INPUT) {
+        precision = inType.getIntervalPrecision();
+    } else if (int64Input == TIMESTAMP_INPUT ||
+               int64Input == TIMESTAMPTZ_INPUT) {
+        precision = inType.getTimestampPrecision();
+    }
+    vint unit = 1;
+    for (int32 digit = precision; digit >= 0 && digit < 6; ++digit) {
+        unit *= 10;
+    }
+    return unit;
+}
+
+// Precision and scale of the argument: NUMERIC(p, s) as declared, INTEGER
+// and the other int64 inputs as NUMERIC(19, 0). Reports an error under name
+// for any other type.
+static void inputPrecisionScale(const VerticaType &inType, const char *name,
+                                int32 &p_in, int32 &s_in)
+{
+    // Its values count months, not microseconds, and a month has no fixed
+    // length to average them in.
+    if (inType.isIntervalYM()) {
+        vt_report_error(0,
+            "%s does not support INTERVAL YEAR TO MONTH input", name);
+    }
+    if (int64InputOf(inType) != NOT_INT64_INPUT) {
+        p_in = INTEGER_PRECISION;
+        s_in = 0;
+        return;
+    }
+    if (!inType.isNumeric()) {
+        vt_report_error(0,
+            "%s expects a NUMERIC/DECIMAL, INTEGER, INTERVAL or "
+            "TIMESTAMP input type", name);
+    }
+    p_in = inType.getNumericPrecision();
+    s_in = inType.getNumericScale();
+    if (p_in <= 0 || p_in > MAX_NUMERIC_PRECISION) {
+        vt_report_error(0,
+            "%s: invalid input NUMERIC precision %d", name, p_in);
+    }
+}
+
+// Adds the NUMERIC type of an average of inType to outputTypes. Grow
+// precision/scale a bit, but keep within Vertica limits.
+//   p_out = min(1024, p_in + 5)
+//   s_out = s_in + (p_out - p_in)
+// All added digits go to the scale, so the result keeps the input's
+// p_in - s_in integer digits and any average (which is bounded by the
+// largest input) fits, even when p_out is clamped to 1024. Errors are
+// reported under name, and the column is named columnName, or name when
+// there is none.
+static void addAverageType(const VerticaType &inType, const char *name,
+                           SizedColumnTypes &outputTypes,
+                           const char *columnName = 0)
+{
+    int32 p_in;
+    int32 s_in;
+    inputPrecisionScale(inType, name, p_in, s_in);
+
+    int32 p_out = p_in + AVG_EXTRA_DIGITS;
+    if (p_out > MAX_NUMERIC_PRECISION) {
+        p_out = MAX_NUMERIC_PRECISION;
+    }
+
+    int32 s_out = s_in + (p_out - p_in);
+    if (s_out < 0) {
+        s_out = 0;
+    }
+
+    outputTypes.addNumeric(p_out, s_out, columnName ? columnName : name);
+}
+
+// Reads the optional max_rows parameter: the most non-NULL rows any one
+// group may aggregate. Defaults to MAX_ROW_COUNT (no limit). A bad value is
+// reported under name.
+static vint maxRowsParameter(ServerInterface &srvInterface, const char *name)
+{
+    ParamReader params = srvInterface.getParamReader();
+    if (!params.containsParameter("max_rows")) {
+        return MAX_ROW_COUNT;
+    }
+    const vint maxRows = params.getIntRef("max_rows");
+    if (maxRows == vint_null || maxRows < 1) {
+        vt_report_error(0,
+            "%s: max_rows must be a positive integer", name);
+    }
+    return maxRows;
+}
+
+// Reads the optional compact_state parameter (default false).
+static bool compactStateParameter(ServerInterface &srvInterface)
+{
+    ParamReader params = srvInterface.getParamReader();
+    return params.containsParameter("compact_state") &&
+           params.getBoolRef("compact_state") == vbool_true;
+}
+
+// Digits the SUM needs above the input's precision for up to maxRows rows:
+// |sum| < maxRows * 10^p_in <= 10^(p_in + d) for d = digits10(maxRows - 1).
+// 19 for the default maxRows; 9 for max_rows = 1000000000.
+static int32 rowCountDigitsFor(vint maxRows)
+{
+    int32 digits = 0;
+    for (vint n = maxRows - 1; n > 0; n /= 10) {
+        digits++;
+    }
+    return digits;
+}
+
+// Precision of the intermediate SUM for a NUMERIC(p_in, *) input:
+//   p_sum = p_in + rowDigits
+// See ExactAvgFactory::getIntermediateTypes() for the reasoning. Above 1024
+// the SUM no longer fits a NUMERIC and is kept as a VARBINARY of
+// sumWordsFor(p_sum) words instead.
+static int32 sumPrecisionFor(int32 p_in, int32 rowDigits)
+{
+    return p_in + rowDigits;
+}
+
+// 64-bit words that hold any p_sum-digit SUM, counted the way VNumeric
+// does: p / 19 + 1.
+static int32 sumWordsFor(int32 p_sum)
+{
+    return p_sum / 19 + 1;
+}
+
+/*
+ * Word-level accumulation kernels.
+ *
+ * VNumeric words are two's complement, most significant word first. The
+ * generic VNumeric::accumulate() loops over a runtime word count and
+ * re-derives the operand alignment for every call. Since the input and SUM
+ * word counts are fixed for the whole query, we instantiate one fully
+ * unrolled kernel per width and pick it once in setup().
+ */
+
+// dst += src + carry; returns the carry out. Written with 64-bit halves
+// rather than an unsigned __int128 sum: inlined into long unrolled chains,
+// GCC would otherwise spill the 128-bit temporaries to the stack.
+static inline unsigned char addWithCarry(uint64 &dst, uint64 src,
+                                         unsigned char carry)
+{
+    const uint64 t = dst + src;
+    const uint64 r = t + carry;
+    const unsigned char out = (t < src) | (r < t);
+    dst = r;
+    return out;
+}
+
+// Adds in[0..I] into sum[0..I], least significant word (index I) first.
+template <int I>
+struct CarryChain
+{
+    static inline unsigned char add(uint64 *sum, const uint64 *in,
+                                    unsigned char carry)
+    {
+        carry = addWithCarry(sum[I], in[I], carry);
+        return CarryChain<I - 1>::add(sum, in, carry);
+    }
+};
+
+template <>
+struct CarryChain<-1>
+{
+    static inline unsigned char add(uint64 *, const uint64 *,
+                                    unsigned char carry)
+    {
+        return carry;
+    }
+};
+
+// Adds in[0..I] ^ flip into the independent 128-bit lanes[0..I]; no carries
+// cross lanes.
+template <int I>
+struct LaneChain
+{
+    static inline void add(unsigned __int128 *lanes, const uint64 *in,
+                           uint64 flip)
+    {
+        lanes[I] += in[I] ^ flip;
+        LaneChain<I - 1>::add(lanes, in, flip);
+    }
+};
+
+template <>
+struct LaneChain<-1>
+{
+    static inline void add(unsigned __int128 *, const uint64 *, uint64) {}
+};
+
+/*
+ * sum += X, or sum -= X if subtract, where
+ *
+ *   X = sum_i lanes[i] * 2^(64 * (laneWords - 1 - i))
+ *       - negatives * 2^(64 * laneWords)
+ *
+ * i.e. adds a block that was accumulated carry-save into the SUM with a
+ * single carry-propagating pass. lanes[] is MSW first, like VNumeric words,
+ * and is cleared on return. Subtraction adds the one's complement of X's
+ * words with an initial carry of one.
+ *
+ * Each lane is the sum of at most `rows` 64-bit words, so the value carried
+ * out of any lane is below `rows`, as is the final carry into the word above
+ * the input width. Lanes therefore cannot overflow before 2^64 rows, which is
+ * more than a vint row count can reach, so blocks never need an early flush.
+ */
+static void flushLanes(uint64 *sum, int32 sumWords,
+                       unsigned __int128 *lanes, int32 laneWords,
+                       uint64 negatives, bool subtract = false)
+{
+    const int32 highWords = sumWords - laneWords;
+    const uint64 flip = subtract ? ~0ULL : 0ULL;
+    unsigned __int128 pending = 0;
+    unsigned char carry = subtract ? 1 : 0;
+
+    for (int32 i = laneWords - 1; i >= 0; --i) {
+        const unsigned __int128 t = lanes[i] + pending;
+        pending = t >> 64;
+        carry = addWithCarry(sum[highWords + i],
+                             static_cast<uint64>(t) ^ flip, carry);
+        lanes[i] = 0;
+    }
+
+    // Every negative input was added as its unsigned N-word pattern, which
+    // is 2^(64N) too large; take those back out of the word above the input.
+    const int64 high = static_cast<int64>(static_cast<uint64>(pending)) -
+                       static_cast<int64>(negatives);
+    const uint64 ext = high < 0 ? ~0ULL : 0ULL;
+    for (int32 i = highWords - 1; i >= 0; --i) {
+        const uint64 word = (i == highWords - 1) ? static_cast<uint64>(high) : ext;
+        carry = addWithCarry(sum[i], word ^ flip, carry);
+    }
+}
+
+/*
+ * Kernels are wrapped in class templates so that KernelPicker can select an
+ * instantiation by runtime word count.
+ */
+
+// sum (sumWords words) += in (Words words, sign-extended); sumWords >= Words.
+template <int Words>
+struct AccumulateWords
+{
+    typedef void (*Fn)(uint64 *sum, int32 sumWords, const uint64 *in);
+
+    static void run(uint64 *sum, int32 sumWords, const uint64 *in)
+    {
+        const int32 highWords = sumWords - Words;
+        unsigned char carry = CarryChain<Words - 1>::add(sum + highWords, in, 0);
+
+        const uint64 ext = static_cast<int64>(in[0]) < 0 ? ~0ULL : 0ULL;
+        for (int32 i = highWords - 1; i >= 0; --i) {
+            carry = addWithCarry(sum[i], ext, carry);
+        }
+    }
+};
+
+/*
+ * Adds every non-NULL NUMERIC of a block (Words words each) into sum and
+ * returns the number of rows added.
+ *
+ * Per row, each input word goes into its own 128-bit lane and negative inputs
+ * are only counted, so the cost is Words lane adds with no carry chain and no
+ * sign extension into the wider SUM. Carries are resolved once per block by
+ * flushLanes().
+ */
+template <int Words>
+struct CarrySaveBlock
+{
+    typedef vint (*Fn)(BlockReader &argReader, uint64 *sum, int32 sumWords);
+
+    static vint run(BlockReader &argReader, uint64 *sum, int32 sumWords)
+    {
+        unsigned __int128 lanes[Words] = {};
+        uint64 negatives = 0;
+        vint rows = 0;
+
+        do {
+            const VNumeric &input = argReader.getNumericRef(0);
+            if (!input.isNull()) {
+                LaneChain<Words - 1>::add(lanes, input.words, 0);
+                negatives += input.words[0] >> 63;
+                rows++;
+            }
+        } while (argReader.next());
+
+        flushLanes(sum, sumWords, lanes, Words, negatives);
+        return rows;
+    }
+};
+
+/*
+ * Adds every non-NULL NUMERIC of a short block straight into the SUM, one
+ * carry chain per row, and returns the number of rows added.
+ *
+ * SignMagnitudeBlock clears and flushes two full lane sets per call, which
+ * dominates when GROUP BY hands aggregateArrs() runs of only a few rows;
+ * this kernel has no per-call setup at all.
+ */
+template <int Words>
+struct DirectBlock
+{
+    typedef vint (*Fn)(BlockReader &argReader, uint64 *sum, int32 sumWords);
+
+    static vint run(BlockReader &argReader, uint64 *sum, int32 sumWords)
+    {
+        vint rows = 0;
+        do {
+            const VNumeric &input = argReader.getNumericRef(0);
+            if (!input.isNull()) {
+                AccumulateWords<Words>::run(sum, sumWords, input.words);
+                rows++;
+            }
+        } while (argReader.next());
+        return rows;
+    }
+};
+
+/*
+ * Sign-magnitude variant of CarrySaveBlock for wide inputs.
+ *
+ * Declared precision is usually far larger than the data, so most words of
+ * a wide input are pure sign extension (0 or ~0). Positive values add into
+ * posLanes; negative values add the one's complement of their words into
+ * negLanes (the +1 that completes each negation is added once per block).
+ * The two magnitudes are subtracted once, when the block is flushed into
+ * the SUM.
+ *
+ * A value that fits in its two low words (|v| < 2^127, about 38 digits)
+ * adds only those two words; anything wider adds all of them. The test is
+ * a fixed-length OR over the high words rather than a scan for the first
+ * significant word, so each row costs one branch that is predictable as
+ * long as the column's values have a consistent width.
+ */
+template <int Words>
+struct SignMagnitudeBlock
+{
+    typedef vint (*Fn)(BlockReader &argReader, uint64 *sum, int32 sumWords);
+
+    enum { Narrow = Words < 2 ? Words : 2 };
+
+    static vint run(BlockReader &argReader, uint64 *sum, int32 sumWords)
+    {
+        unsigned __int128 posLanes[Words] = {};
+        unsigned __int128 negLanes[Words] = {};
+        uint64 negatives = 0;
+        vint rows = 0;
+
+        do {
+            const VNumeric &input = argReader.getNumericRef(0);
+            if (input.isNull()) {
+                continue;
+            }
+            const uint64 *w = input.words;
+            const uint64 neg = w[0] >> 63;
+            const uint64 mask = 0 - neg;
+            unsigned __int128 *lanes = neg ? negLanes : posLanes;
+
+            // Nonzero unless every word above the low Narrow ones, and the
+            // top bit of the highest of those, is a sign bit.
+            uint64 wide = Narrow < Words ? (w[Words - Narrow] ^ mask) >> 63 : 0;
+            for (int32 i = 0; i < Words - Narrow; ++i) {
+                wide |= w[i] ^ mask;
+            }
+            if (wide) {
+                LaneChain<Words - 1>::add(lanes, w, mask);
+            } else {
+                LaneChain<Narrow - 1>::add(lanes + Words - Narrow,
+                                           w + Words - Narrow, mask);
+            }
+            negatives += neg;
+            rows++;
+        } while (argReader.next());
+
+        negLanes[Words - 1] += negatives;
+        flushLanes(sum, sumWords, posLanes, Words, 0);
+        flushLanes(sum, sumWords, negLanes, Words, 0, true);
+        return rows;
+    }
+};
+
+/*
+ * Run-length kernel for input sorted (or clustered) on the aggregated
+ * column, e.g. a status or price-tier column in a projection ordered by it.
+ * Each row is compared with the previous non-NULL value, and a run of k
+ * equal values is added once as value * k: one 64x64-bit multiply per word
+ * into CarrySaveBlock's 128-bit lanes. A lane then holds at most
+ * sum(value word * run length) < 2^64 * rows, so it still cannot overflow.
+ * Inside a run a row costs one compare instead of an add per word.
+ *
+ * On unsorted data the compare and multiply are pure overhead, so every
+ * block starts with a probe: if the first RUN_PROBE_ROWS non-NULL rows
+ * average runs shorter than MIN_RUN_LENGTH, the kernel flushes what it has
+ * and returns true with the reader on the next row, and the caller hands
+ * the rest of the block to the next kernel. rows is increased by the rows
+ * added either way.
+ */
+template <int Words>
+struct RunLengthBlock
+{
+    typedef bool (*Fn)(BlockReader &argReader, uint64 *sum, int32 sumWords,
+                       vint &rows);
+
+    static bool run(BlockReader &argReader, uint64 *sum, int32 sumWords,
+                    vint &rows)
+    {
+        unsigned __int128 lanes[Words] = {};
+        uint64 negatives = 0;
+        // The current run's value; it points into the block, which stays put
+        // while the reader moves on.
+        const uint64 *value = 0;
+        uint64 length = 0;
+        vint runs = 0;
+        bool probeFailed = false;
+        const vint probeEnd = rows + RUN_PROBE_ROWS;
+
+        do {
+            const VNumeric &input = argReader.getNumericRef(0);
+            if (input.isNull()) {
+                continue;
+            }
+            rows++;
+            if (value && sameWords(value, input.words)) {
+                length++;
+            } else {
+                if (value) {
+                    addRun(lanes, value, length, negatives);
+                }
+                value = input.words;
+                length = 1;
+                runs++;
+            }
+            if (rows == probeEnd && runs * MIN_RUN_LENGTH > RUN_PROBE_ROWS) {
+                probeFailed = true;
+                break;
+            }
+        } while (argReader.next());
+
+        if (value) {
+            addRun(lanes, value, length, negatives);
+        }
+        flushLanes(sum, sumWords, lanes, Words, negatives);
+        return probeFailed && argReader.next();
+    }
+
+    // Unequal values almost always differ in the least significant word,
+    // so it is checked on its own; the rest is compared without branches.
+    static inline bool sameWords(const uint64 *a, const uint64 *b)
+    {
+        if (a[Words - 1] != b[Words - 1]) {
+            return false;
+        }
+        uint64 diff = 0;
+        for (int32 i = 0; i < Words - 1; ++i) {
+            diff |= a[i] ^ b[i];
+        }
+        return diff == 0;
+    }
+
+    static inline void addRun(unsigned __int128 *lanes, const uint64 *value,
+                              uint64 length, uint64 &negatives)
+    {
+        for (int32 i = 0; i < Words; ++i) {
+            lanes[i] += static_cast<unsigned __int128>(value[i]) * length;
+        }
+        negatives += (value[0] >> 63) * length;
+    }
+};
+
+// sum (sumWords >= 2 words) += value, sign-extended over the SUM.
+static inline void accumulateInt128(uint64 *sum, int32 sumWords,
+                                    __int128 value)
+{
+    const unsigned __int128 bits = static_cast<unsigned __int128>(value);
+    const uint64 words[2] = { static_cast<uint64>(bits >> 64),
+                              static_cast<uint64>(bits) };
+    AccumulateWords<2>::run(sum, sumWords, words);
+}
+
+/*
+ * Optimistic int128 kernel for a block of values that fit their two low
+ * words (|v| < 2^127, about 38 digits). Declared precision is usually far
+ * larger than the data, and such values need no lanes at all: each one is
+ * added to a native __int128 subtotal, which is added to the SUM when the
+ * block ends (or, on the rare overflow, early).
+ *
+ * BlockReader only moves forward, so the block cannot be checked first.
+ * Instead each row's high words are checked as it is added. At the first
+ * row that needs more than two words the kernel flushes its subtotal and
+ * returns true with the reader still on that row; the caller hands the rest
+ * of the block to the wide kernel. rows is increased by the rows added.
+ */
+template <int Words>
+struct NarrowBlock
+{
+    typedef bool (*Fn)(BlockReader &argReader, uint64 *sum, int32 sumWords,
+                       vint &rows);
+
+    static bool run(BlockReader &argReader, uint64 *sum, int32 sumWords,
+                    vint &rows)
+    {
+        __int128 subtotal = 0;
+        bool wideFound = false;
+
+        do {
+            const VNumeric &input = argReader.getNumericRef(0);
+            if (input.isNull()) {
+                continue;
+            }
+            const uint64 *w = input.words;
+            const uint64 ext =
+                static_cast<uint64>(static_cast<int64>(w[Words - 2]) >> 63);
+            uint64 high = 0;
+            for (int32 i = 0; i < Words - 2; ++i) {
+                high |= w[i] ^ ext;
+            }
+            if (high != 0) {
+                wideFound = true;
+                break;
+            }
+            const __int128 value = static_cast<__int128>(
+                (static_cast<unsigned __int128>(w[Words - 2]) << 64) |
+                w[Words - 1]);
+            __int128 next;
+            if (__builtin_add_overflow(subtotal, value, &next)) {
+                accumulateInt128(sum, sumWords, subtotal);
+                next = value;
+            }
+            subtotal = next;
+            rows++;
+        } while (argReader.next());
+
+        if (subtotal != 0) {
+            accumulateInt128(sum, sumWords, subtotal);
+        }
+        return wideFound;
+    }
+};
+
+// One-word inputs have their own int128 lane (aggregateInt128()); this only
+// completes KernelPicker's table and hands every row on.
+template <>
+struct NarrowBlock<1>
+{
+    typedef bool (*Fn)(BlockReader &argReader, uint64 *sum, int32 sumWords,
+                       vint &rows);
+
+    static bool run(BlockReader &, uint64 *, int32, vint &) { return true; }
+};
+
+// Returns &Kernel<words>::run for 1 <= words <= N, or 0.
+template <template <int> class Kernel, int N>
+struct KernelPicker
+{
+    static typename Kernel<1>::Fn pick(int32 words)
+    {
+        return words == N ? &Kernel<N>::run
+                          : KernelPicker<Kernel, N - 1>::pick(words);
+    }
+};
+
+template <template <int> class Kernel>
+struct KernelPicker<Kernel, 0>
+{
+    static typename Kernel<1>::Fn pick(int32) { return 0; }
+};
+
+/*
+ * Multi-word by single-word arithmetic for terminate().
+ *
+ * The divisor of an average is always the 64-bit row count, so instead of a
+ * general multi-word VNumeric::div() we scale the SUM's magnitude to the
+ * result scale and run one short division over its words. Each quotient
+ * word costs two multiplications against a reciprocal of the divisor that
+ * is computed once per group (Moller & Granlund, "Improved division by
+ * invariant integers", 2011, which refines Granlund & Montgomery's
+ * multiply-by-reciprocal division), instead of a hardware 128/64 division.
+ */
+
+// 10^0 .. 10^19, the powers of ten that fit in a uint64.
+static const uint64 POW10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+// u = -u over n words (MSW first).
+static void negateWords(uint64 *u, int32 n)
+{
+    unsigned char carry = 1;
+    for (int32 i = n - 1; i >= 0; --i) {
+        u[i] = ~u[i];
+        carry = addWithCarry(u[i], 0, carry);
+    }
+}
+
+// u *= f over n words (MSW first); returns the word carried out of u[0].
+static uint64 multiplyWords(uint64 *u, int32 n, uint64 f)
+{
+    uint64 carry = 0;
+    for (int32 i = n - 1; i >= 0; --i) {
+        const unsigned __int128 t = static_cast<unsigned __int128>(u[i]) * f + carry;
+        u[i] = static_cast<uint64>(t);
+        carry = static_cast<uint64>(t >> 64);
+    }
+    return carry;
+}
+
+// u = 10^exponent over n words (MSW first), which must hold it.
+static void powerOfTen(uint64 *u, int32 n, int32 exponent)
+{
+    memset(u, 0, static_cast<size_t>(n) * sizeof(uint64));
+    u[n - 1] = 1;
+    for (int32 digits = 0; digits < exponent; digits += 19) {
+        const int32 step = exponent - digits < 19 ? exponent - digits : 19;
+        multiplyWords(u, n, POW10[step]);
+    }
+}
+
+// floor((2^128 - 1) / d) - 2^64 for a normalized d (top bit set).
+static inline uint64 reciprocalWord(uint64 d)
+{
+    return static_cast<uint64>(
+        ((static_cast<unsigned __int128>(~d) << 64) | ~0ULL) / d);
+}
+
+// (u1:u0) / d for a normalized d, u1 < d and v = reciprocalWord(d).
+// Returns the quotient and stores the remainder in r.
+static inline uint64 divide2by1(uint64 u1, uint64 u0, uint64 d, uint64 v,
+                                uint64 &r)
+{
+    unsigned __int128 q = static_cast<unsigned __int128>(v) * u1;
+    q += (static_cast<unsigned __int128>(u1) << 64) | u0;
+    uint64 q1 = static_cast<uint64>(q >> 64) + 1;
+    const uint64 q0 = static_cast<uint64>(q);
+    uint64 rem = u0 - q1 * d;
+    if (rem > q0) {
+        q1--;
+        rem += d;
+    }
+    if (rem >= d) {
+        q1++;
+        rem -= d;
+    }
+    r = rem;
+    return q1;
+}
+
+// u /= d in place over n unsigned words (MSW first), d != 0; returns the
+// remainder. The dividend is shifted on the fly so that d is normalized.
+static uint64 divideWords(uint64 *u, int32 n, uint64 d)
+{
+    const int shift = __builtin_clzll(d);
+    const uint64 dn = d << shift;
+    const uint64 v = reciprocalWord(dn);
+
+    uint64 r = shift ? u[0] >> (64 - shift) : 0;
+    for (int32 i = 0; i < n; ++i) {
+        uint64 next = u[i] << shift;
+        if (shift && i + 1 < n) {
+            next |= u[i + 1] >> (64 - shift);
+        }
+        u[i] = divide2by1(r, next, dn, v, r);
+    }
+    return r >> shift;
+}
+
+/*
+ * out = round(sum * 10^scaleUp / count), rounding half away from zero like
+ * VNumeric::div(), where sum is a two's-complement value of sumWords words
+ * and 0 <= scaleUp <= 19 aligns the SUM's scale with out's.
+ *
+ * scratch must hold sumWords + 1 words. Returns false, leaving out
+ * untouched, if the result does not fit out's words.
+ */
+static bool divideByCount(const uint64 *sum, int32 sumWords, int32 scaleUp,
+                          uint64 count, VNumeric &out, uint64 *scratch)
+{
+    const int32 n = sumWords + 1;
+    const bool neg = static_cast<int64>(sum[0]) < 0;
+
+    // |sum| < 2^(64 * sumWords - 1), so one extra word absorbs the scaling.
+    scratch[0] = neg ? ~0ULL : 0ULL;
+    for (int32 i = 0; i < sumWords; ++i) {
+        scratch[i + 1] = sum[i];
+    }
+    if (neg) {
+        negateWords(scratch, n);
+    }
+    multiplyWords(scratch, n, POW10[scaleUp]);
+
+    const uint64 rem = divideWords(scratch, n, count);
+    if (rem >= count - rem) {
+        unsigned char carry = 1;
+        for (int32 i = n - 1; i >= 0 && carry; --i) {
+            carry = addWithCarry(scratch[i], 0, carry);
+        }
+    }
+
+    // The magnitude must leave the sign bit of out's top word clear.
+    const int32 outWords = out.nwds;
+    const int32 skip = n - outWords;
+    for (int32 i = 0; i < skip; ++i) {
+        if (scratch[i] != 0) {
+            return false;
+        }
+    }
+    if (skip >= 0 && static_cast<int64>(scratch[skip]) < 0) {
+        return false;
+    }
+
+    for (int32 i = 0; i < outWords; ++i) {
+        out.words[i] = i + skip >= 0 ? scratch[i + skip] : 0;
+    }
+    if (neg) {
+        negateWords(out.words, outWords);
+    }
+    return true;
+}
+
+/*
+ * out = sum / rowCount, or NULL when rowCount is 0 (like AVG): the final
+ * step of terminate(), shared with the analytic functions. sum (sumWords
+ * words at scale sumScale) must be exact for rowCount rows. The divisor is
+ * a single 64-bit word, so this is a short division over the SUM's words
+ * that produces NUMERIC(p_out, s_out) directly (see divideByCount()).
+ * scratch must hold sumWords + 1 words; errors are reported under name.
+ */
+static void writeAverage(const char *name, const uint64 *sum, int32 sumWords,
+                         int32 sumScale, vint rowCount, VNumeric &out,
+                         uint64 *scratch)
+{
+    if (rowCount == 0) {
+        out.setNull();
+        return;
+    }
+
+    const int32 scaleUp = out.getScale() - sumScale;
+    if (scaleUp < 0 || scaleUp > 19) {
+        vt_report_error(0,
+            "%s: internal error: result scale %d cannot be "
+            "derived from intermediate scale %d",
+            name, out.getScale(), sumScale);
+    }
+
+    if (!divideByCount(sum, sumWords, scaleUp, static_cast<uint64>(rowCount),
+                       out, scratch)) {
+        vt_report_error(0,
+            "%s: the average does not fit in the result type "
+            "NUMERIC(%d, %d)",
+            name, out.getPrecision(), out.getScale());
+    }
+}
+
+/*
+ * out = sum, or NULL when rowCount is 0 (like SUM): terminate() for
+ * exact_sum. out has the SUM's scale and at most its words; the words
+ * dropped must be sign extension, and when out is NUMERIC(1024) clamped
+ * from a wider SUM, |sum| must also stay below limit = 10^1024.
+ * scratch must hold sumWords words.
+ */
+static void writeSum(const uint64 *sum, int32 sumWords, vint rowCount,
+                     const uint64 *limit, VNumeric &out, uint64 *scratch)
+{
+    if (rowCount == 0) {
+        out.setNull();
+        return;
+    }
+
+    const int32 outWords = out.nwds;
+    const int32 dropped = sumWords - outWords;
+    const bool neg = static_cast<int64>(sum[0]) < 0;
+    const uint64 ext = neg ? ~0ULL : 0ULL;
+    bool fits = (static_cast<int64>(sum[dropped]) < 0) == neg;
+    for (int32 i = 0; i < dropped; ++i) {
+        fits = fits && sum[i] == ext;
+    }
+    if (fits && limit) {
+        memcpy(scratch, sum + dropped, static_cast<size_t>(outWords) * sizeof(uint64));
+        if (neg) {
+            negateWords(scratch, outWords);
+        }
+        int32 i = 0;
+        while (i < outWords - 1 && scratch[i] == limit[i]) {
+            ++i;
+        }
+        fits = scratch[i] < limit[i];
+    }
+    if (!fits) {
+        vt_report_error(0,
+            "exact_sum: the sum does not fit in the result type "
+            "NUMERIC(%d, %d)",
+            out.getPrecision(), out.getScale());
+    }
+
+    memcpy(out.words, sum + dropped, static_cast<size_t>(outWords) * sizeof(uint64));
+}
+
+// The average of an int64 input's SUM, rounded half away from zero like
+// the NUMERIC results to a multiple of unit (int64InputUnit()). |sum| <
+// 2^126, so its two low words hold it, and the average is bounded by the
+// largest input, so it fits an int64.
+static vint roundedInt64Average(const uint64 *sum, int32 sumWords, vint count,
+                                vint unit)
+{
+    const unsigned __int128 bits =
+        (static_cast<unsigned __int128>(sum[sumWords - 2]) << 64) |
+        sum[sumWords - 1];
+    const bool neg = static_cast<int64>(sum[sumWords - 2]) < 0;
+    const unsigned __int128 magnitude = neg ? -bits : bits;
+    // count * unit < 2^63 * 10^6, well inside 128 bits.
+    const unsigned __int128 divisor =
+        static_cast<unsigned __int128>(count) * static_cast<uint64>(unit);
+    uint64 quotient = static_cast<uint64>(magnitude / divisor);
+    const unsigned __int128 remainder = magnitude % divisor;
+    if (remainder >= divisor - remainder) {
+        quotient++;
+    }
+    const vint average = static_cast<vint>(quotient) * unit;
+    return neg ? -average : average;
+}
+
+/*
+ * Exact FLOAT averages (ExactAvgFloatFactory).
+ *
+ * Every finite double is an integer multiple of 2^-1074, the smallest
+ * subnormal, and below 2^1024, so the sum of up to 2^63 of them is an
+ * integer multiple of 2^-1074 below 2^(1024 + 63): a fixed-point number of
+ * 1074 + 1087 bits plus a sign, i.e. FLOAT_FINITE_WORDS two's-complement
+ * words (a Kulisch accumulator). Addition is then exact and associative, so
+ * the result no longer depends on row order or on how the rows were split
+ * into partials; the average is rounded once, in terminate().
+ *
+ * The FLOAT SUM is that integer plus, one word each above it, the counts of
+ * +Infinity, -Infinity and NaN inputs:
+ *
+ *   sum = finite + posInf * 2^2240 + negInf * 2^2304 + nan * 2^2368
+ *
+ * so it is still one two's-complement integer of FLOAT_SUM_WORDS words,
+ * stored like a wide SUM (a VARBINARY, or trimmed with compact_state), and
+ * combine() merges partials with the same multi-word add as for NUMERIC.
+ */
+
+// Fixed-point position of the FLOAT SUM's least significant bit: 2^-1074.
+static const int32 FLOAT_FRACTION_BITS = 1074;
+
+// Words of the finite part: 64 * 35 = 2240 >= 1074 + 1087 + 1 bits.
+static const int32 FLOAT_FINITE_WORDS = 35;
+
+// The finite part plus the +Infinity, -Infinity and NaN counts.
+static const int32 FLOAT_SUM_WORDS = FLOAT_FINITE_WORDS + 3;
+
+// accumulateFloats() adds each value to two int64 lanes, lane i weighing
+// 2^(32 * i) of the finite part: a chunk below 2^32 and the significand's
+// remaining bits, below 2^53. Positions run to 2045 + 52, so 65 lanes; a
+// lane moves by less than 2^53 per row, so the lanes are flushed into the
+// SUM every FLOAT_LANE_ROWS rows, well before they could overflow.
+static const int32 FLOAT_LANES = 65;
+static const vint FLOAT_LANE_ROWS = 512;
+
+// Adds lanes[lo..hi] (lane i weighs 2^(32 * i)) into the finite part of
+// sum, sign-extended over the whole FLOAT SUM, and clears them.
+static void flushFloatLanes(uint64 *sum, int64 *lanes, int32 lo, int32 hi)
+{
+    uint64 words[FLOAT_FINITE_WORDS] = {};
+    __int128 carry = 0;
+    for (int32 i = lo; i < 2 * FLOAT_FINITE_WORDS; ++i) {
+        if (i <= hi) {
+            carry += lanes[i];
+            lanes[i] = 0;
+        }
+        const uint64 chunk = static_cast<uint32>(static_cast<uint64>(carry));
+        words[FLOAT_FINITE_WORDS - 1 - i / 2] |= chunk << (32 * (i % 2));
+        carry >>= 32;
+        if (i >= hi && (carry == 0 || carry == -1) && i % 2 == 1) {
+            // The rest is sign extension.
+            for (int32 w = FLOAT_FINITE_WORDS - 2 - i / 2; w >= 0; --w) {
+                words[w] = static_cast<uint64>(static_cast<int64>(carry));
+            }
+            break;
+        }
+    }
+    AccumulateWords<FLOAT_FINITE_WORDS>::run(sum, FLOAT_SUM_WORDS, words);
+}
+
+// Adds every non-NULL FLOAT of a block into sum (FLOAT_SUM_WORDS words) and
+// returns the number of rows added. The lanes between the lowest and the
+// highest one touched are flushed once per block, so a block of values of
+// similar magnitude costs three lane adds per row and a few words to flush.
+static vint accumulateFloats(BlockReader &argReader, uint64 *sum)
+{
+    int64 lanes[FLOAT_LANES] = {};
+    int32 lo = FLOAT_LANES;
+    int32 hi = -1;
+    uint64 specials[3] = {}; // NaN, -Infinity, +Infinity counts (MSW first)
+    vint rows = 0;
+    vint laneRows = 0;
+
+    do {
+        const vfloat value = argReader.getFloatRef(0);
+        if (vfloatIsNull(value)) {
+            continue;
+        }
+        rows++;
+
+        uint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        const uint32 exponent = static_cast<uint32>(bits >> 52) & 0x7FF;
+        const uint64 fraction = bits & ((1ULL << 52) - 1);
+        if (exponent == 0x7FF) {
+            specials[fraction != 0 ? 0 : (bits >> 63) ? 1 : 2]++;
+            continue;
+        }
+
+        // value = significand * 2^(position - 1074): the bits below the
+        // next 32-bit boundary go to one lane, the rest (< 2^53) to the next.
+        const uint64 significand = exponent ? fraction | (1ULL << 52) : fraction;
+        const uint32 position = exponent ? exponent - 1 : 0;
+        const uint32 shift = position % 32;
+        const int32 lane = static_cast<int32>(position / 32);
+        const int64 low = static_cast<int64>((significand << shift) & 0xFFFFFFFFULL);
+        const int64 high = static_cast<int64>(significand >> (32 - shift));
+        const int64 sign = static_cast<int64>(bits) >> 63; // 0 or -1
+
+        lanes[lane] += (low ^ sign) - sign;
+        lanes[lane + 1] += (high ^ sign) - sign;
+        lo = lane < lo ? lane : lo;
+        hi = lane + 1 > hi ? lane + 1 : hi;
+
+        if (++laneRows == FLOAT_LANE_ROWS) {
+            flushFloatLanes(sum, lanes, lo, hi);
+            lo = FLOAT_LANES;
+            hi = -1;
+            laneRows = 0;
+        }
+    } while (argReader.next());
+
+    if (hi >= 0) {
+        flushFloatLanes(sum, lanes, lo, hi);
+    }
+    if (specials[0] | specials[1] | specials[2]) {
+        unsigned char carry = 0;
+        for (int32 i = 2; i >= 0; --i) {
+            carry = addWithCarry(sum[i], specials[i], carry);
+        }
+    }
+    return rows;
+}
+
+// Bits [lo, lo + 64) of the n-word unsigned integer u (MSW first), counting
+// from its least significant bit; bits above u read as 0.
+static uint64 bitsAt(const uint64 *u, int32 n, int32 lo)
+{
+    const int32 word = lo / 64;
+    const int32 shift = lo % 64;
+    uint64 result = word < n ? u[n - 1 - word] >> shift : 0;
+    if (shift != 0 && word + 1 < n) {
+        result |= u[n - 2 - word] << (64 - shift);
+    }
+    return result;
+}
+
+// True if any of bits [0, end) of u is set.
+static bool anyBitsBelow(const uint64 *u, int32 n, int32 end)
+{
+    for (int32 word = 0; word * 64 < end && word < n; ++word) {
+        uint64 w = u[n - 1 - word];
+        if (end - word * 64 < 64) {
+            w &= (1ULL << (end - word * 64)) - 1;
+        }
+        if (w != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * The FLOAT SUM divided by count, rounded once to the nearest double (ties
+ * to even), with IEEE semantics for the special values: NaN if any input
+ * was NaN or both infinities occurred, otherwise the infinity that
+ * occurred. scratch must hold FLOAT_FINITE_WORDS + 2 words.
+ */
+static vfloat floatAverage(const uint64 *sum, uint64 count, uint64 *scratch)
+{
+    // The finite part is the low words read as a signed number; when it is
+    // negative it has borrowed 1 from the counts above it.
+    const uint64 *finite = sum + (FLOAT_SUM_WORDS - FLOAT_FINITE_WORDS);
+    const bool neg = static_cast<int64>(finite[0]) < 0;
+    uint64 specials[3] = { sum[0], sum[1], sum[2] };
+    if (neg) {
+        unsigned char carry = 1;
+        for (int32 i = 2; i >= 0; --i) {
+            carry = addWithCarry(specials[i], 0, carry);
+        }
+    }
+    if (specials[0] != 0 || (specials[1] != 0 && specials[2] != 0)) {
+        return std::numeric_limits<vfloat>::quiet_NaN();
+    }
+    if (specials[1] != 0 || specials[2] != 0) {
+        return specials[1] != 0 ? -std::numeric_limits<vfloat>::infinity()
+                                : std::numeric_limits<vfloat>::infinity();
+    }
+
+    // q = |finite| * 2^128 / count, so that q has at least 64 bits more
+    // than the result needs; the remainder only matters as a sticky bit.
+    const int32 n = FLOAT_FINITE_WORDS + 2;
+    for (int32 i = 0; i < FLOAT_FINITE_WORDS; ++i) {
+        scratch[i] = finite[i];
+    }
+    if (neg) {
+        negateWords(scratch, FLOAT_FINITE_WORDS);
+    }
+    scratch[n - 2] = 0;
+    scratch[n - 1] = 0;
+    const bool inexact = divideWords(scratch, n, count) != 0;
+
+    // Highest set bit of q; the average is q * 2^-(1074 + 128).
+    int32 top = -1;
+    for (int32 i = 0; i < n; ++i) {
+        if (scratch[i] != 0) {
+            top = 64 * (n - 1 - i) + 63 - __builtin_clzll(scratch[i]);
+            break;
+        }
+    }
+    const int32 fractionBits = FLOAT_FRACTION_BITS + 128;
+    if (top < 0) {
+        return neg ? -0.0 : 0.0;
+    }
+
+    // Keep 53 significant bits, or fewer below the normal range, where the
+    // last kept bit is 2^-1074.
+    int32 ulp = top - fractionBits - 52;
+    if (ulp < -FLOAT_FRACTION_BITS) {
+        ulp = -FLOAT_FRACTION_BITS;
+    }
+    const int32 drop = ulp + fractionBits; // >= 128
+    // An average below 2^-1075 keeps no bits at all; it rounds to 0 or
+    // 2^-1074 from the half and sticky bits alone.
+    const int32 keptBits = top - drop + 1;
+    uint64 mantissa = 0;
+    if (keptBits >= 64) {
+        mantissa = bitsAt(scratch, n, drop);
+    } else if (keptBits > 0) {
+        mantissa = bitsAt(scratch, n, drop) & ((1ULL << keptBits) - 1);
+    }
+    const bool half = (bitsAt(scratch, n, drop - 1) & 1) != 0;
+    const bool below = inexact || anyBitsBelow(scratch, n, drop - 1);
+    if (half && (below || (mantissa & 1))) {
+        mantissa++;
+    }
+
+    const vfloat magnitude = std::ldexp(static_cast<vfloat>(mantissa), ulp);
+    return neg ? -magnitude : magnitude;
+}
+
+/*
+ * Compact intermediate state (USING PARAMETERS compact_state = true).
+ *
+ * Instead of a fixed-width SUM column plus an INTEGER count, the whole
+ * state is one VARBINARY:
+ *
+ *   [cnt as an unsigned LEB128 varint][k SUM words, MSW first]
+ *
+ * where k is the fewest words that still hold the SUM in two's complement
+ * (0 for a zero SUM). VARBINARY values travel at their actual length, so a
+ * partial shipped to combine() costs bytes in proportion to the SUM's
+ * magnitude rather than its declared precision. Words are moved with
+ * memcpy, so the buffer needs no alignment.
+ */
+
+// Longest varint of a non-negative vint: 63 bits, 7 per byte.
+static const int32 MAX_VARINT_BYTES = 9;
+
+// Maximum encoded length of a state whose SUM has sumWords words.
+static int32 compactStateBytesFor(int32 sumWords)
+{
+    return MAX_VARINT_BYTES + sumWords * static_cast<int32>(sizeof(uint64));
+}
+
+// Encodes (cnt, sum[0..n)) into out, which must hold
+// compactStateBytesFor(n) bytes; returns the encoded length.
+static vsize encodeState(char *out, vint cnt, const uint64 *sum, int32 n)
+{
+    vsize len = 0;
+    uint64 c = static_cast<uint64>(cnt);
+    while (c >= 0x80) {
+        out[len++] = static_cast<char>(c | 0x80);
+        c >>= 7;
+    }
+    out[len++] = static_cast<char>(c);
+
+    // Drop leading words that only repeat the sign of the words below.
+    const uint64 ext = static_cast<int64>(sum[0]) < 0 ? ~0ULL : 0ULL;
+    int32 first = 0;
+    while (first < n && sum[first] == ext &&
+           (first + 1 < n ? ((sum[first + 1] ^ ext) >> 63) == 0 : ext == 0)) {
+        ++first;
+    }
+    const vsize bytes = static_cast<vsize>(n - first) * sizeof(uint64);
+    memcpy(out + len, sum + first, bytes);
+    return len + bytes;
+}
+
+// Decodes a state written by encodeState() into cnt and the n-word sum,
+// sign-extending the stored words.
+static void decodeState(const VString &state, vint &cnt, uint64 *sum, int32 n)
+{
+    const unsigned char *in =
+        reinterpret_cast<const unsigned char *>(state.data());
+    uint64 c = 0;
+    vsize pos = 0;
+    int shift = 0;
+    do {
+        c |= static_cast<uint64>(in[pos] & 0x7F) << shift;
+        shift += 7;
+    } while (in[pos++] & 0x80);
+    cnt = static_cast<vint>(c);
+
+    const int32 k = static_cast<int32>((state.length() - pos) / sizeof(uint64));
+    memcpy(sum + n - k, in + pos, static_cast<size_t>(k) * sizeof(uint64));
+    const uint64 ext =
+        k > 0 && static_cast<int64>(sum[n - k]) < 0 ? ~0ULL : 0ULL;
+    for (int32 i = 0; i < n - k; ++i) {
+        sum[i] = ext;
+    }
+}
+
+/*
+ * One SUM column of an intermediate row, as 64-bit words (MSW first).
+ *
+ * A NUMERIC column is worked on in place. A SUM wider than NUMERIC(1024)
+ * lives in a VARBINARY, whose bytes Vertica does not promise to align to 8
+ * bytes; reading them as uint64 would be undefined, and GCC's vectorized
+ * word loops may assume the alignment. load() therefore copies such a SUM
+ * into an aligned buffer allocated in setup(), and store() copies it back.
+ */
+class SumColumn
+{
+public:
+    SumColumn() : column(0), bytes(0), wide(false), own(0), other(0) {}
+
+    void setup(ServerInterface &srvInterface, size_t column, int32 words,
+               bool wide)
+    {
+        this->column = column;
+        this->bytes = static_cast<vsize>(words) * sizeof(uint64);
+        this->wide = wide;
+        if (wide) {
+            own = static_cast<uint64 *>(srvInterface.allocator->alloc(bytes));
+            other = static_cast<uint64 *>(srvInterface.allocator->alloc(bytes));
+        }
+    }
+
+    // The SUM in aggs' current row. Changes to a VARBINARY SUM only reach
+    // the row through store().
+    template <class Aggs>
+    uint64 *load(Aggs &aggs) const
+    {
+        return loadInto(aggs, own);
+    }
+
+    // Like load(), into a second buffer: a partial that combine() adds to
+    // the SUM load() returned.
+    template <class Aggs>
+    const uint64 *loadOther(Aggs &aggs) const
+    {
+        return loadInto(aggs, other);
+    }
+
+    // Writes back the SUM load() returned.
+    void store(IntermediateAggs &aggs) const
+    {
+        if (wide) {
+            aggs.getStringRef(column).copy(reinterpret_cast<const char *>(own),
+                                           bytes);
+        }
+    }
+
+    // SUM = 0.
+    void clear(IntermediateAggs &aggs) const
+    {
+        if (wide) {
+            memset(own, 0, bytes);
+            store(aggs);
+        } else {
+            aggs.getNumericRef(column).setZero();
+        }
+    }
+
+private:
+    template <class Aggs>
+    uint64 *loadInto(Aggs &aggs, uint64 *buffer) const
+    {
+        if (!wide) {
+            return aggs.getNumericRef(column).words;
+        }
+        memcpy(buffer, aggs.getStringRef(column).data(), bytes);
+        return buffer;
+    }
+
+    size_t column;
+    vsize bytes;
+    bool wide;
+    uint64 *own;
+    uint64 *other;
+};
+
+/**
+ * exact_avg(NUMERIC(p,s)) -> NUMERIC(p_out, s_out)
+ *
+ * Goals:
+ *  - Be as fast as possible by using a dynamically-sized intermediate SUM type,
+ *    not always NUMERIC(1024, ...).
+ *  - Be 100% accurate whenever the exact SUM can fit in Vertica's NUMERIC(1024, ...).
+ *  - If the exact SUM cannot be represented within NUMERIC(1024, ...), detect this
+ *    and raise a clear error instead of returning a wrong answer.
+ *
+ * Theory:
+ *  - Input type: NUMERIC(p_in, s_in).
+ *  - Worst-case magnitude of each value: < 10^(p_in - s_in).
+ *  - Sum of N such values can need up to:
+ *        p_needed = p_in + ceil(log10(N))
+ *    decimal digits of precision in total (integer + fractional).
+ *  - Vertica caps p at 1024, so if p_needed > 1024, no exact sum is possible
+ *    for any implementation (built-in or UDX).
+ *
+ * Implementation:
+ *  - Intermediate SUM type: NUMERIC(p_sum, s_sum) with
+ *        p_sum = p_in + 19,
+ *        s_sum = s_in.
+ *    19 extra digits covers any possible 64-bit row count (N <= 9e18, 19 digits).
+ *    USING PARAMETERS max_rows = M lowers the 19 to digits10(M - 1), and
+ *    aggregate()/combine() fail if a group ever counts more than M rows.
+ *  - When p_sum > 1024 the SUM cannot be a NUMERIC, so it is kept in a
+ *    VARBINARY instead: the same two's-complement 64-bit words, MSW first,
+ *    just p_sum / 19 + 1 of them (at most 55). Every kernel below already
+ *    works on raw words, so only where the words live changes.
+ *  - The intermediate state is just (sum, cnt); p_in is the same for every
+ *    group, so it is taken from the input type in setup() instead.
+ *  - For NUMERIC(p_in <= 18) inputs, aggregate() sums the raw int64 words of
+ *    a block into a native __int128 and writes it back to the two-word SUM
+ *    once per call, instead of calling VNumeric::accumulate() per row.
+ *  - Wider inputs are summed carry-save: each input word is added into its
+ *    own 128-bit lane and carries are propagated into the SUM once per
+ *    block (CarrySaveBlock<N>, unrolled for the input's word count N).
+ *  - Inputs of 4+ words are summed sign-magnitude instead: positives and
+ *    negated negatives go into separate lane sets, touching only each
+ *    value's significant words, and are subtracted when the block is
+ *    flushed (SignMagnitudeBlock<N>).
+ *  - combine() adds partial SUMs with an add-with-carry chain unrolled for
+ *    the SUM's word count (AccumulateWords<N>).
+ *  - With compact_state = true, (sum, cnt) is instead one VARBINARY holding
+ *    a varint count and only the SUM's significant words (encodeState()),
+ *    to cut the bytes shuffled between nodes. Each call expands it into a
+ *    full-width scratch SUM, works there, and writes it back trimmed.
+ *  - Blocks of fewer than 16 rows of 4+ word inputs, such as the per-group
+ *    runs GROUP BY passes to aggregateArrs(), are added row by row
+ *    (DirectBlock<N>), skipping the lanes' per-block setup and flush.
+ *  - All kernels are chosen once per function instance in setup().
+ *  - In terminate(), the SUM is exact by construction, so the UDX returns
+ *    the exact average, computed by a short division of the SUM's words by
+ *    the 64-bit row count. The average is bounded by the largest input, and
+ *    NUMERIC(p_out, s_out) keeps all p_in - s_in integer digits, so it
+ *    always fits.
+ */
+class ExactAvg : public AggregateFunction
+{
+public:
+    // sumResult: terminate() returns the SUM itself (exact_sum) instead of
+    // dividing it by the row count.
+    explicit ExactAvg(bool sumResult = false)
+        : sumResult(sumResult), sumScale(0), sumLen(0), wideSum(false),
+          compactState(false), intInput(false), int64Input(NOT_INT64_INPUT),
+          floatInput(false), useInt128Lane(false), blockKernel(0),
+          shortBlockKernel(0), runLengthKernel(0), narrowKernel(0),
+          shortNarrowKernel(0), combineKernel(0), divWords(0), sumLimit(0),
+          stateWords(0), otherWords(0), stateBuf(0), maxRows(MAX_ROW_COUNT)
+    {}
+
+    // GROUP BY entry point, written out instead of InlineAggregate(). The
+    // macro calls the virtual aggregate() once per group, re-entering its try
+    // block and re-testing the state layout each time. Here each group costs
+    // one updateCols(), which re-points arg_reader and intAggs at the group's
+    // rows and tuple, and one kernel call; the (typically short) runs of wide
+    // inputs take DirectBlock instead of the sign-magnitude lanes.
+    virtual void aggregateArrs(ServerInterface &srvInterface, void **dstTuples,
+                               int doff, const void *arr, int stride,
+                               const void *rcounts, int rcstride, int count,
+                               IntermediateAggs &intAggs,
+                               std::vector<int> &intOffsets,
+                               BlockReader &arg_reader)
+    {
+        try {
+            char *arg = const_cast<char *>(static_cast<const char *>(arr));
+            const char *rowCounts = static_cast<const char *>(rcounts);
+
+            for (int i = 0; i < count; ++i) {
+                const int rows =
+                    static_cast<int>(*reinterpret_cast<const vpos *>(rowCounts));
+                if (rows > 0) {
+                    updateCols(arg_reader, arg, rows, intAggs,
+                               static_cast<char *>(dstTuples[i]) + doff,
+                               intOffsets);
+                    if (compactState) {
+                        aggregateCompact(arg_reader, intAggs);
+                    } else {
+                        aggregateInto(arg_reader, sumColumn.load(intAggs),
+                                      intAggs.getIntRef(1));
+                        sumColumn.store(intAggs);
+                    }
+                }
+                arg += stride;
+                rowCounts += rcstride;
+            }
+        } catch (std::exception &e) {
+            vt_report_error(0,
+                "%s: error in aggregateArrs: [%s]", functionName(), e.what());
+        }
+    }
+
+    // Size the SUM from the input type, pick the accumulation path once per
+    // function instance, and allocate terminate()'s scratch space up front.
+    virtual void setup(ServerInterface &srvInterface,
+                       const SizedColumnTypes &argTypes)
+    {
+        const VerticaType &inType = argTypes.getColumnType(0);
+        floatInput = inType.isFloat();
+        int64Input = int64InputOf(inType);
+        intInput = int64Input != NOT_INT64_INPUT;
+        int64Unit = int64InputUnit(inType, int64Input);
+        maxRows = maxRowsParameter(srvInterface, functionName());
+
+        int32 sumWords;
+        if (floatInput) {
+            // The Kulisch accumulator: always a VARBINARY, whatever max_rows.
+            sumScale = 0;
+            wideSum = true;
+            sumWords = FLOAT_SUM_WORDS;
+            useInt128Lane = false;
+        } else {
+            int32 p_in;
+            inputPrecisionScale(inType, functionName(), p_in, sumScale);
+            const int32 p_sum = sumPrecisionFor(p_in, rowCountDigitsFor(maxRows));
+            wideSum = p_sum > MAX_NUMERIC_PRECISION;
+            sumWords = sumWordsFor(p_sum);
+            // A small max_rows can leave NUMERIC(p <= 18) with a one-word
+            // SUM, which the carry-save kernel handles.
+            useInt128Lane = !intInput && p_in <= MAX_INT128_LANE_PRECISION &&
+                            sumWords == 2;
+        }
+        sumLen = sumWords;
+        sumColumn.setup(srvInterface, 0, sumWords, wideSum);
+        // INTEGER and FLOAT inputs have their own paths and need no word
+        // kernels.
+        if (!intInput && !floatInput) {
+            const int32 inWords = inType.getNumericWordCount();
+            blockKernel = inWords >= SIGN_MAGNITUDE_MIN_WORDS
+                ? KernelPicker<SignMagnitudeBlock, MAX_NUMERIC_WORDS>::pick(inWords)
+                : KernelPicker<CarrySaveBlock, MAX_NUMERIC_WORDS>::pick(inWords);
+            shortBlockKernel = inWords >= SIGN_MAGNITUDE_MIN_WORDS
+                ? KernelPicker<DirectBlock, MAX_NUMERIC_WORDS>::pick(inWords)
+                : blockKernel;
+            runLengthKernel = useInt128Lane
+                ? 0
+                : KernelPicker<RunLengthBlock, MAX_NUMERIC_WORDS>::pick(inWords);
+            narrowKernel = useInt128Lane
+                ? 0
+                : KernelPicker<NarrowBlock, MAX_NUMERIC_WORDS>::pick(inWords);
+            shortNarrowKernel =
+                inWords < SIGN_MAGNITUDE_MIN_WORDS ? narrowKernel : 0;
+        }
+        combineKernel =
+            KernelPicker<AccumulateWords, MAX_SUM_WORDS>::pick(sumWords);
+
+        // terminate() runs once per group and must not hit the heap, so its
+        // division scratch comes from the query allocator once per instance.
+        const int32 divLen = sumWords + 1;
+        divWords = static_cast<uint64 *>(srvInterface.allocator->alloc(
+            static_cast<size_t>(divLen) * sizeof(uint64)));
+
+        // exact_sum clamps its result to NUMERIC(1024); past that, terminate()
+        // checks the SUM against 10^1024 = 10^(19 * 53) * 10^17.
+        if (sumResult && wideSum) {
+            const int32 limitWords = sumWordsFor(MAX_NUMERIC_PRECISION);
+            sumLimit = static_cast<uint64 *>(srvInterface.allocator->alloc(
+                static_cast<size_t>(limitWords) * sizeof(uint64)));
+            powerOfTen(sumLimit, limitWords, MAX_NUMERIC_PRECISION);
+        }
+
+        // A compact state is expanded into stateWords (and, in combine(),
+        // each partial into otherWords) and re-encoded through stateBuf.
+        compactState = compactStateParameter(srvInterface);
+        if (compactState) {
+            const size_t wordBytes = static_cast<size_t>(sumWords) * sizeof(uint64);
+            stateWords = static_cast<uint64 *>(srvInterface.allocator->alloc(wordBytes));
+            otherWords = static_cast<uint64 *>(srvInterface.allocator->alloc(wordBytes));
+            stateBuf = static_cast<char *>(srvInterface.allocator->alloc(
+                static_cast<size_t>(compactStateBytesFor(sumWords))));
+        }
+    }
+
+    // Initialize intermediate state: sum = 0, cnt = 0
+    virtual void initAggregate(ServerInterface &srvInterface,
+                               IntermediateAggs &aggs)
+    {
+        try {
+            static const uint64 zero[MAX_SUM_WORDS] = {};
+            if (compactState) {
+                storeState(aggs.getStringRef(0), 0, zero);
+                return;
+            }
+
+            sumColumn.clear(aggs);
+
+            vint &cnt = aggs.getIntRef(1);
+            cnt = 0;
+        } catch (std::exception &e) {
+            vt_report_error(0,
+                "%s: error in initAggregate: [%s]", functionName(), e.what());
+        }
+    }
+
+    // Aggregate input rows into (sum, cnt)
+    virtual void aggregate(ServerInterface &srvInterface,
+                           BlockReader &argReader,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            if (compactState) {
+                aggregateCompact(argReader, aggs);
+                return;
+            }
+
+            aggregateInto(argReader, sumColumn.load(aggs), aggs.getIntRef(1));
+            sumColumn.store(aggs);
+        } catch (std::exception &e) {
+            vt_report_error(0,
+                "%s: error in aggregate: [%s]", functionName(), e.what());
+        }
+    }
+
+    // Combine partial aggregates (sum, cnt) from different nodes/threads
+    virtual void combine(ServerInterface &srvInterface,
+                         IntermediateAggs &aggs,
+                         MultipleIntermediateAggs &aggsOther)
+    {
+        try {
+            if (compactState) {
+                VString &state = aggs.getStringRef(0);
+                vint myCnt;
+                decodeState(state, myCnt, stateWords, sumLen);
+
+                do {
+                    vint otherCnt;
+                    decodeState(aggsOther.getStringRef(0), otherCnt,
+                                otherWords, sumLen);
+                    combineKernel(stateWords, sumLen, otherWords);
+                    myCnt += otherCnt;
+                } while (aggsOther.next());
+                checkRowCount(myCnt);
+
+                storeState(state, myCnt, stateWords);
+                return;
+            }
+
+            uint64 *mySum = sumColumn.load(aggs);
+            vint &myCnt = aggs.getIntRef(1);
+
+            do {
+                const uint64 *otherSum = sumColumn.loadOther(aggsOther);
+                const vint &otherCnt = aggsOther.getIntRef(1);
+
+                combineKernel(mySum, sumLen, otherSum);
+                myCnt += otherCnt;
+            } while (aggsOther.next());
+            checkRowCount(myCnt);
+            sumColumn.store(aggs);
+        } catch (std::exception &e) {
+            vt_report_error(0,
+                "%s: error in combine: [%s]", functionName(), e.what());
+        }
+    }
+
+    // Finalize: avg = sum / cnt
+    virtual void terminate(ServerInterface &srvInterface,
+                           BlockWriter &resWriter,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            const uint64 *sum;
+            vint rowCount;
+            if (compactState) {
+                decodeState(aggs.getStringRef(0), rowCount, stateWords, sumLen);
+                sum = stateWords;
+            } else {
+                sum = sumColumn.load(aggs);
+                rowCount = aggs.getIntRef(1);
+            }
+
+            if (rowCount < 0) {
+                vt_report_error(0,
+                    "%s: internal error: negative row count %lld",
+                    functionName(), static_cast<long long>(rowCount));
+            }
+
+            // FLOAT: the average rounded once to the nearest double.
+            if (floatInput) {
+                resWriter.setFloat(0, rowCount > 0
+                    ? floatAverage(sum, static_cast<uint64>(rowCount), divWords)
+                    : vfloat_null);
+                return;
+            }
+
+            // INTERVAL/TIMESTAMP/TIMESTAMPTZ: the average in microseconds,
+            // rounded to the argument's precision, as a value of its type.
+            if (intInput && int64Input != INTEGER_INPUT) {
+                if (rowCount == 0) {
+                    resWriter.setNull(0);
+                    return;
+                }
+                const vint average =
+                    roundedInt64Average(sum, sumLen, rowCount, int64Unit);
+                if (int64Input == INTERVAL_INPUT) {
+                    resWriter.setInterval(0, average);
+                } else if (int64Input == TIMESTAMP_INPUT) {
+                    resWriter.setTimestamp(0, average);
+                } else {
+                    resWriter.setTimestampTz(0, average);
+                }
+                return;
+            }
+
+            // The SUM is exact: getIntermediateTypes() sized it as
+            // p_sum = p_in + digits10(max_rows - 1) digits (as a VARBINARY
+            // when that exceeds 1024), and rowCount <= max_rows is enforced
+            // in aggregate()/combine(), so |sum| < rowCount * 10^p_in fits.
+            if (sumResult) {
+                writeSum(sum, sumLen, rowCount, sumLimit,
+                         resWriter.getNumericRef(0), divWords);
+                return;
+            }
+            writeAverage(functionName(), sum, sumLen, sumScale, rowCount,
+                         resWriter.getNumericRef(0), divWords);
+        } catch (std::exception &e) {
+            vt_report_error(
+                0,
+                "%s: error in terminate (overflow or divide): [%s]",
+                functionName(), e.what());
+        }
+    }
+
+private:
+    // exact_sum rather than exact_avg (see the constructor).
+    bool sumResult;
+
+    // Scale of the SUM (the input's s_in), from the argument type in setup().
+    int32 sumScale;
+
+    // Words in the SUM, and whether they live in a VARBINARY (p_sum > 1024,
+    // or the FLOAT accumulator) rather than a NUMERIC.
+    int32 sumLen;
+    bool wideSum;
+
+    // Access to the SUM column (sum, cnt) keeps it in.
+    SumColumn sumColumn;
+
+    // compact_state: (sum, cnt) is one trimmed VARBINARY (encodeState()).
+    bool compactState;
+
+    // True when the input is INTEGER, INTERVAL, TIMESTAMP or TIMESTAMPTZ
+    // rather than NUMERIC, and which of them it is.
+    bool intInput;
+    Int64Input int64Input;
+
+    // INTERVAL/TIMESTAMP/TIMESTAMPTZ: the microseconds terminate() rounds the
+    // average to, so it keeps the argument's declared precision.
+    vint int64Unit;
+
+    // True when the input is FLOAT (ExactAvgFloatFactory): the SUM is the
+    // FLOAT_SUM_WORDS Kulisch accumulator and the result a FLOAT.
+    bool floatInput;
+
+    // True when the input is NUMERIC(p <= 18): one int64 word per value and a
+    // two-word SUM.
+    bool useInt128Lane;
+
+    // CarrySaveBlock<N> or SignMagnitudeBlock<N> for the input's word count
+    // N, and the kernel for blocks of fewer than SHORT_BLOCK_ROWS rows
+    // (DirectBlock<N> in place of SignMagnitudeBlock<N>).
+    CarrySaveBlock<1>::Fn blockKernel;
+    DirectBlock<1>::Fn shortBlockKernel;
+
+    // RunLengthBlock<N>, which probes every full-size block first; 0 for the
+    // int128 lane, which already costs a single add per row.
+    RunLengthBlock<1>::Fn runLengthKernel;
+
+    // NarrowBlock<N>, tried before the block kernels on every block; 0 for
+    // the int128 lane.
+    NarrowBlock<1>::Fn narrowKernel;
+
+    // narrowKernel again for short blocks of 2-3 word inputs, which would
+    // otherwise pay for CarrySaveBlock's lanes; 0 for 4+ words, where a
+    // NarrowBlock attempt that fails on the first row costs about as much
+    // as DirectBlock saves.
+    NarrowBlock<1>::Fn shortNarrowKernel;
+
+    // AccumulateWords<N> for the SUM's word count N.
+    AccumulateWords<1>::Fn combineKernel;
+
+    // Scratch for terminate()'s division: SUM words + 1, allocated once in
+    // setup() from srvInterface.allocator.
+    uint64 *divWords;
+
+    // exact_sum with p_sum > 1024: 10^1024, the bound a SUM must stay below
+    // to fit the NUMERIC(1024, s) result; 0 otherwise.
+    uint64 *sumLimit;
+
+    // compact_state scratch, allocated in setup(): the expanded SUM, the
+    // expanded partial being combined, and the encoding buffer.
+    uint64 *stateWords;
+    uint64 *otherWords;
+    char *stateBuf;
+
+    // The max_rows parameter; the SUM type only has room for this many rows.
+    vint maxRows;
+
+    // sum += every non-NULL input; count only non-NULL rows (SQL AVG
+    // semantics).
+    void aggregateInto(BlockReader &argReader, uint64 *sum, vint &cnt) const
+    {
+        if (floatInput) {
+            cnt += accumulateFloats(argReader, sum);
+        } else if (intInput) {
+            aggregateInt64(argReader, sum, sumLen, cnt);
+        } else if (useInt128Lane) {
+            aggregateInt128(argReader, sum, cnt);
+        } else {
+            cnt += aggregateBlock(argReader, sum);
+        }
+        checkRowCount(cnt);
+    }
+
+    // Runs a block through the kernel chain; each kernel hands the rest of
+    // the block to the next when the data does not suit it: for full-size
+    // blocks RunLengthBlock's probe, then NarrowBlock, then the block
+    // kernel; short blocks skip the probe and may skip NarrowBlock too.
+    vint aggregateBlock(BlockReader &argReader, uint64 *sum) const
+    {
+        vint rows = 0;
+        if (argReader.getNumRows() < SHORT_BLOCK_ROWS) {
+            if (!shortNarrowKernel ||
+                shortNarrowKernel(argReader, sum, sumLen, rows)) {
+                rows += shortBlockKernel(argReader, sum, sumLen);
+            }
+        } else if (runLengthKernel(argReader, sum, sumLen, rows) &&
+                   narrowKernel(argReader, sum, sumLen, rows)) {
+            rows += blockKernel(argReader, sum, sumLen);
+        }
+        return rows;
+    }
+
+    // aggregateInto() for a compact state: expand, add, store trimmed.
+    void aggregateCompact(BlockReader &argReader, IntermediateAggs &aggs) const
+    {
+        VString &state = aggs.getStringRef(0);
+        vint cnt;
+        decodeState(state, cnt, stateWords, sumLen);
+        aggregateInto(argReader, stateWords, cnt);
+        storeState(state, cnt, stateWords);
+    }
+
+    // The SQL function errors are reported under.
+    const char *functionName() const
+    {
+        return sumResult ? "exact_sum" : "exact_avg";
+    }
+
+    // Writes (cnt, sum) into a compact state.
+    void storeState(VString &state, vint cnt, const uint64 *sum) const
+    {
+        state.copy(stateBuf, encodeState(stateBuf, cnt, sum, sumLen));
+    }
+
+    void checkRowCount(vint cnt) const
+    {
+        if (cnt > maxRows) {
+            vt_report_error(0,
+                "%s: a group has more than max_rows = %lld non-NULL rows; "
+                "raise max_rows or omit it",
+                functionName(), static_cast<long long>(maxRows));
+        }
+    }
+
+    /*
+     * Fast path for NUMERIC(p_in <= 18).
+     *
+     * Each input value is a single two's-complement int64 word (NULL is
+     * vint_null), and the SUM is NUMERIC(p_in + 19) = two words, high word
+     * first. |sum| < 9.3e18 rows * 1e18 < 2^127, so a native __int128 holds
+     * the running total for the whole block without overflow; it is loaded
+     * from and stored back to the SUM words once per aggregate() call.
+     */
+    static void aggregateInt128(BlockReader &argReader, uint64 *sum, vint &cnt)
+    {
+        __int128 acc = static_cast<__int128>(
+            (static_cast<unsigned __int128>(sum[0]) << 64) | sum[1]);
+        vint rows = 0;
+
+        do {
+            const int64 value =
+                static_cast<int64>(argReader.getNumericRef(0).words[0]);
+            if (value != vint_null) {
+                acc += value;
+                rows++;
+            }
+        } while (argReader.next());
+
+        const unsigned __int128 bits = static_cast<unsigned __int128>(acc);
+        sum[0] = static_cast<uint64>(bits >> 64);
+        sum[1] = static_cast<uint64>(bits);
+        cnt += rows;
+    }
+
+    /*
+     * INTEGER input (and INTERVAL, TIMESTAMP and TIMESTAMPTZ, which are int64
+     * microseconds in the same slot, read through getIntRef()): the same
+     * native __int128 running total, but the SUM is
+     * NUMERIC(19 + 19) = three words (two with a max_rows below 1e18), so the
+     * block's subtotal is added into it at the end of the block.
+     * |subtotal| <= rows * 2^63 < 2^127 cannot overflow.
+     */
+    static void aggregateInt64(BlockReader &argReader, uint64 *sum,
+                               int32 sumWords, vint &cnt)
+    {
+        __int128 subtotal = 0;
+        vint rows = 0;
+
+        do {
+            const vint value = argReader.getIntRef(0);
+            if (value != vint_null) {
+                subtotal += value;
+                rows++;
+            }
+        } while (argReader.next());
+
+        accumulateInt128(sum, sumWords, subtotal);
+        cnt += rows;
+    }
+};
+
+
+/**
+ * Factory: validates arguments, chooses return type, and defines
+ * intermediate (sum, cnt) types.
+ */
+class ExactAvgFactory : public AggregateFunctionFactory
+{
+public:
+    // One NUMERIC argument, numeric return
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addNumeric();   // input must be NUMERIC/DECIMAL
+        returnType.addNumeric(); // actual p,s decided in getReturnType()
+    }
+
+    // Decide output NUMERIC(p_out, s_out) based on input NUMERIC(p_in, s_in)
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
+    {
+        if (inputTypes.getColumnCount() != 1) {
+            vt_report_error(0,
+                "%s expects exactly one argument", functionName());
+        }
+
+        addAverageType(inputTypes.getColumnType(0), functionName(),
+                       outputTypes);
+    }
+
+    // Decide intermediate (sum, cnt) types
+    virtual void getIntermediateTypes(ServerInterface &srvInterface,
+                                      const SizedColumnTypes &inputTypes,
+                                      SizedColumnTypes &intermediateTypes)
+    {
+        if (inputTypes.getColumnCount() != 1) {
+            vt_report_error(0,
+                "%s expects exactly one argument", functionName());
+        }
+
+        int32 p_in;
+        int32 s_in;
+        inputPrecisionScale(inputTypes.getColumnType(0), functionName(), p_in,
+                            s_in);
+
+        /*
+         * Performance vs safety for the SUM precision:
+         *
+         *   - Worst-case we need: p_needed = p_in + ceil(log10(N))
+         *   - For a 64-bit row count, N <= 9,223,372,036,854,775,807, so
+         *         ceil(log10(N)) <= 19.
+         *   - So p_in + 19 digits are enough to represent the SUM exactly
+         *     for any possible rowCount within Vertica.
+         *
+         * We choose:
+         *   p_sum = p_in + 19
+         *
+         * This is:
+         *   - Always large enough to hold the exact sum.
+         *   - Cheaper than always using p_sum = 1024 for small/moderate p_in.
+         *
+         * Vertica caps NUMERIC at 1024 digits, so for p_in > 1005 the SUM is
+         * declared as a VARBINARY holding the same 64-bit words a
+         * NUMERIC(p_sum) would have (at most 55 words = 440 bytes). The
+         * average itself is bounded by the largest input, so it still fits
+         * the NUMERIC result type.
+         *
+         * When the caller bounds the group size with max_rows = M, only
+         * digits10(M - 1) extra digits are needed (e.g. 9 for M = 1e9), which
+         * can save a SUM word per group; the row count is then checked
+         * against M as rows are aggregated.
+         */
+        int32 p_sum = sumPrecisionFor(
+            p_in,
+            rowCountDigitsFor(maxRowsParameter(srvInterface, functionName())));
+
+        if (compactStateParameter(srvInterface)) {
+            intermediateTypes.addVarbinary(
+                compactStateBytesFor(sumWordsFor(p_sum)), "state"); // index 0
+            return;
+        }
+
+        if (p_sum > MAX_NUMERIC_PRECISION) {
+            // The words are implicitly scaled by s_in, like the NUMERIC SUM.
+            intermediateTypes.addVarbinary(
+                sumWordsFor(p_sum) * sizeof(uint64), "sum"); // index 0
+            intermediateTypes.addInt("cnt");                 // index 1
+            return;
+        }
+
+        // Keep the same scale for the sum as the input, clamped to [0, p_sum].
+        int32 s_sum = s_in;
+        if (s_sum > p_sum) {
+            s_sum = p_sum;
+        }
+        if (s_sum < 0) {
+            s_sum = 0;
+        }
+
+        intermediateTypes.addNumeric(p_sum, s_sum, "sum"); // index 0
+        intermediateTypes.addInt("cnt");                   // index 1
+    }
+
+    // Optional: max_rows, an upper bound on the non-NULL rows per group, and
+    // compact_state, which trims the intermediate state to its significant
+    // words.
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes)
+    {
+        parameterTypes.addInt("max_rows");
+        parameterTypes.addBool("compact_state");
+    }
+
+    virtual AggregateFunction *createAggregateFunction(
+        ServerInterface &srvInterface)
+    {
+        return vt_createFuncObject<ExactAvg>(srvInterface.allocator);
+    }
+
+protected:
+    // The SQL function the argument and parameter checks report under;
+    // ExactSumFactory reuses them as exact_sum.
+    virtual const char *functionName() const
+    {
+        return "exact_avg";
+    }
+};
+
+RegisterFactory(ExactAvgFactory);
+
+/**
+ * exact_avg(INTEGER): the same aggregate for INTEGER/BIGINT columns, without
+ * a per-row cast to NUMERIC. The input is summed as int64 in a native
+ * __int128 and treated as NUMERIC(19, 0) everywhere else, so the result is
+ * an exact NUMERIC(24, 5) rather than AVG()'s FLOAT. Registered as an
+ * overload of exact_avg (see 2_register_and_test.sql).
+ */
+class ExactAvgIntFactory : public ExactAvgFactory
+{
+public:
+    // One INTEGER argument, numeric return
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addInt();
+        returnType.addNumeric();
+    }
+};
+
+RegisterFactory(ExactAvgIntFactory);
+
+
+/**
+ * exact_avg(FLOAT): the average of FLOAT (double) columns with the SUM kept
+ * exactly in a fixed-point Kulisch accumulator (see accumulateFloats()) and
+ * the result rounded once to the nearest FLOAT. Unlike AVG(), the result
+ * does not depend on row order or on how the rows are spread over nodes
+ * and threads. NaN and ±Infinity inputs give the IEEE result.
+ */
+class ExactAvgFloatFactory : public ExactAvgFactory
+{
+public:
+    // One FLOAT argument, FLOAT return
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addFloat();
+        returnType.addFloat();
+    }
+
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
+    {
+        if (inputTypes.getColumnCount() != 1) {
+            vt_report_error(0,
+                "exact_avg expects exactly one argument");
+        }
+        outputTypes.addFloat("exact_avg");
+    }
+
+    // (sum, cnt) with the sum always a FLOAT_SUM_WORDS VARBINARY; max_rows
+    // only bounds the row count, the accumulator has room for any.
+    virtual void getIntermediateTypes(ServerInterface &srvInterface,
+                                      const SizedColumnTypes &inputTypes,
+                                      SizedColumnTypes &intermediateTypes)
+    {
+        if (inputTypes.getColumnCount() != 1) {
+            vt_report_error(0,
+                "exact_avg expects exactly one argument");
+        }
+        maxRowsParameter(srvInterface, "exact_avg"); // validate it
+
+        if (compactStateParameter(srvInterface)) {
+            intermediateTypes.addVarbinary(
+                compactStateBytesFor(FLOAT_SUM_WORDS), "state"); // index 0
+            return;
+        }
+        intermediateTypes.addVarbinary(
+            FLOAT_SUM_WORDS * sizeof(uint64), "sum"); // index 0
+        intermediateTypes.addInt("cnt");              // index 1
+    }
+};
+
+RegisterFactory(ExactAvgFloatFactory);
+
+/**
+ * exact_avg(INTERVAL), exact_avg(TIMESTAMP), exact_avg(TIMESTAMPTZ): the
+ * same aggregate for durations and points in time. Their values are int64
+ * microseconds, summed exactly like INTEGER (with the same NUMERIC(19, 0)
+ * intermediate SUM), and the result is the average rounded half away from
+ * zero to the argument's declared seconds precision (the microsecond by
+ * default), as a value of the argument's own type, typmod included.
+ * INTERVAL YEAR TO MONTH counts months and is rejected.
+ */
+class ExactAvgInt64TypeFactory : public ExactAvgFactory
+{
+public:
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
+    {
+        if (inputTypes.getColumnCount() != 1) {
+            vt_report_error(0,
+                "exact_avg expects exactly one argument");
+        }
+        outputTypes.addArg(inputTypes.getColumnType(0), "exact_avg");
+    }
+};
+
+class ExactAvgIntervalFactory : public ExactAvgInt64TypeFactory
+{
+public:
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addInterval();
+        returnType.addInterval();
+    }
+};
+
+class ExactAvgTimestampFactory : public ExactAvgInt64TypeFactory
+{
+public:
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addTimestamp();
+        returnType.addTimestamp();
+    }
+};
+
+class ExactAvgTimestampTzFactory : public ExactAvgInt64TypeFactory
+{
+public:
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addTimestampTz();
+        returnType.addTimestampTz();
+    }
+};
+
+RegisterFactory(ExactAvgIntervalFactory);
+RegisterFactory(ExactAvgTimestampFactory);
+RegisterFactory(ExactAvgTimestampTzFactory);
+
+/**
+ * exact_sum(NUMERIC): the exact SUM that exact_avg accumulates, returned
+ * as NUMERIC(min(1024, p_sum), s_in) with p_sum as in getIntermediateTypes()
+ * (p_in + 19, or fewer digits with max_rows), where SUM() silently
+ * overflows. It is the same ExactAvg with the same kernels, intermediate
+ * types and parameters; only terminate() skips the division. A SUM past
+ * NUMERIC(1024) (p_sum > 1024) is an error rather than a wrong result.
+ */
+class ExactSumFactory : public ExactAvgFactory
+{
+public:
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
+    {
+        if (inputTypes.getColumnCount() != 1) {
+            vt_report_error(0,
+                "%s expects exactly one argument", functionName());
+        }
+
+        int32 p_in;
+        int32 s_in;
+        inputPrecisionScale(inputTypes.getColumnType(0), functionName(), p_in,
+                            s_in);
+        int32 p_out = sumPrecisionFor(
+            p_in,
+            rowCountDigitsFor(maxRowsParameter(srvInterface, functionName())));
+        if (p_out > MAX_NUMERIC_PRECISION) {
+            p_out = MAX_NUMERIC_PRECISION;
+        }
+
+        outputTypes.addNumeric(p_out, s_in, functionName());
+    }
+
+    virtual AggregateFunction *createAggregateFunction(
+        ServerInterface &srvInterface)
+    {
+        return vt_createFuncObject<ExactAvg>(srvInterface.allocator, true);
+    }
+
+protected:
+    virtual const char *functionName() const
+    {
+        return "exact_sum";
+    }
+};
+
+RegisterFactory(ExactSumFactory);
+
+/*
+ * Multi-word arithmetic for the moment aggregates' terminate().
+ *
+ * exact_var_pop, exact_var_samp and exact_stddev divide a combination of
+ * SUMs by n^2 or n(n - 1) (times a power of ten when the result scale is
+ * clamped), which no longer fits the single-word divideWords(), and
+ * exact_stddev also takes a square root. These work on unsigned
+ * magnitudes, MSW first like the SUMs, and run once per group, so they are
+ * plain loops rather than unrolled kernels: Knuth's Algorithm D (TAOCP
+ * vol. 2, 4.3.1) for the division and Newton's iteration on top of it for
+ * the square root.
+ */
+
+// dst += src over n words (MSW first), modulo 2^(64 n).
+static void addWords(uint64 *dst, const uint64 *src, int32 n)
+{
+    unsigned char carry = 0;
+    for (int32 i = n - 1; i >= 0; --i) {
+        carry = addWithCarry(dst[i], src[i], carry);
+    }
+}
+
+// -1, 0 or 1 as a < b, a == b or a > b, both n words.
+static int compareWords(const uint64 *a, const uint64 *b, int32 n)
+{
+    for (int32 i = 0; i < n; ++i) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// dst (dn words) += src (sn words), aligned on the least significant word.
+// src's words above dst's, if any, must be zero.
+static void addMagnitude(uint64 *dst, int32 dn, const uint64 *src, int32 sn)
+{
+    const int32 skip = sn > dn ? sn - dn : 0;
+    unsigned char carry = 0;
+    int32 i = dn - 1;
+    for (int32 j = sn - 1; j >= skip; --j, --i) {
+        carry = addWithCarry(dst[i], src[j], carry);
+    }
+    for (; i >= 0 && carry; --i) {
+        carry = addWithCarry(dst[i], 0, carry);
+    }
+}
+
+// dst (dn words) -= src (sn <= dn words), aligned on the least significant
+// word; the caller guarantees dst >= src.
+static void subtractMagnitude(uint64 *dst, int32 dn, const uint64 *src,
+                              int32 sn)
+{
+    unsigned char carry = 1;
+    int32 i = dn - 1;
+    for (int32 j = sn - 1; j >= 0; --j, --i) {
+        carry = addWithCarry(dst[i], ~src[j], carry);
+    }
+    for (; i >= 0; --i) {
+        carry = addWithCarry(dst[i], ~0ULL, carry);
+    }
+}
+
+// out (an + bn words) = a (an words) * b (bn words).
+static void multiplyMagnitudes(const uint64 *a, int32 an, const uint64 *b,
+                               int32 bn, uint64 *out)
+{
+    memset(out, 0, static_cast<size_t>(an + bn) * sizeof(uint64));
+    for (int32 i = an - 1; i >= 0; --i) {
+        uint64 carry = 0;
+        for (int32 j = bn - 1; j >= 0; --j) {
+            const unsigned __int128 t =
+                static_cast<unsigned __int128>(a[i]) * b[j] + out[i + j + 1] + carry;
+            out[i + j + 1] = static_cast<uint64>(t);
+            carry = static_cast<uint64>(t >> 64);
+        }
+        out[i] = carry;
+    }
+}
+
+/*
+ * q = u / v and u = u % v, for u of un words and v of vn <= un words,
+ * v != 0; q has un words. work must hold un + vn + 1 words.
+ *
+ * Algorithm D: v is shifted so that its top bit is set, then each
+ * quotient word is estimated from the top two words of the running
+ * remainder and v's top word, corrected with v's second word (after which
+ * it is at most one too large), and confirmed by the multiply-subtract.
+ */
+static void divideMagnitudes(uint64 *u, int32 un, const uint64 *v, int32 vn,
+                             uint64 *q, uint64 *work)
+{
+    while (v[0] == 0) {
+        ++v;
+        --vn;
+    }
+    memset(q, 0, static_cast<size_t>(un) * sizeof(uint64));
+
+    if (vn == 1) {
+        memcpy(q, u, static_cast<size_t>(un) * sizeof(uint64));
+        const uint64 r = divideWords(q, un, v[0]);
+        memset(u, 0, static_cast<size_t>(un) * sizeof(uint64));
+        u[un - 1] = r;
+        return;
+    }
+
+    // Normalized divisor d (vn words) and dividend r (un + 1 words).
+    const int shift = __builtin_clzll(v[0]);
+    uint64 *d = work;
+    uint64 *r = work + vn;
+    for (int32 i = 0; i < vn; ++i) {
+        d[i] = v[i] << shift;
+        if (shift && i + 1 < vn) {
+            d[i] |= v[i + 1] >> (64 - shift);
+        }
+    }
+    r[0] = shift ? u[0] >> (64 - shift) : 0;
+    for (int32 i = 0; i < un; ++i) {
+        r[i + 1] = u[i] << shift;
+        if (shift && i + 1 < un) {
+            r[i + 1] |= u[i + 1] >> (64 - shift);
+        }
+    }
+
+    // Quotient word j divides r[j .. j + vn] by d.
+    const int32 m = un - vn;
+    for (int32 j = 0; j <= m; ++j) {
+        const unsigned __int128 top =
+            (static_cast<unsigned __int128>(r[j]) << 64) | r[j + 1];
+        unsigned __int128 qhat = top / d[0];
+        unsigned __int128 rhat = top - qhat * d[0];
+        while ((qhat >> 64) != 0 ||
+               qhat * d[1] > ((rhat << 64) | r[j + 2])) {
+            --qhat;
+            rhat += d[0];
+            if ((rhat >> 64) != 0) {
+                break;
+            }
+        }
+
+        // r[j .. j + vn] -= qhat * d
+        uint64 qword = static_cast<uint64>(qhat);
+        uint64 mulCarry = 0;
+        unsigned char carry = 1;
+        for (int32 i = vn - 1; i >= 0; --i) {
+            const unsigned __int128 p =
+                static_cast<unsigned __int128>(qword) * d[i] + mulCarry;
+            mulCarry = static_cast<uint64>(p >> 64);
+            carry = addWithCarry(r[j + 1 + i], ~static_cast<uint64>(p), carry);
+        }
+        carry = addWithCarry(r[j], ~mulCarry, carry);
+
+        // A borrow out of r[j]: qhat was one too large, so add d back.
+        if (!carry) {
+            --qword;
+            carry = 0;
+            for (int32 i = vn - 1; i >= 0; --i) {
+                carry = addWithCarry(r[j + 1 + i], d[i], carry);
+            }
+            r[j] += carry;
+        }
+        q[vn - 1 + j] = qword;
+    }
+
+    // The remainder is r's last vn words, shifted back.
+    memset(u, 0, static_cast<size_t>(un) * sizeof(uint64));
+    for (int32 i = 0; i < vn; ++i) {
+        const int32 k = m + 1 + i;
+        u[m + i] = shift ? (r[k] >> shift) | (r[k - 1] << (64 - shift)) : r[k];
+    }
+}
+
+// q = round(u / v), half up, for magnitudes u (un words) and v (vn <= un
+// words), v != 0; u is left holding the remainder. work as for
+// divideMagnitudes().
+static void roundedQuotient(uint64 *u, int32 un, const uint64 *v, int32 vn,
+                            uint64 *q, uint64 *work)
+{
+    divideMagnitudes(u, un, v, vn, q, work);
+
+    // Round up when remainder >= v - remainder; the remainder is below v,
+    // so it fits u's last vn words.
+    const uint64 *rem = u + (un - vn);
+    memcpy(work, v, static_cast<size_t>(vn) * sizeof(uint64));
+    subtractMagnitude(work, vn, rem, vn);
+    if (compareWords(rem, work, vn) >= 0) {
+        const uint64 one = 1;
+        addMagnitude(q, un, &one, 1);
+    }
+}
+
+// root = floor(sqrt(y)) for y of n words; root has n words. work must hold
+// 5 n + 1 words.
+static void squareRoot(const uint64 *y, int32 n, uint64 *root, uint64 *work)
+{
+    memset(root, 0, static_cast<size_t>(n) * sizeof(uint64));
+    int32 lead = 0;
+    while (lead < n && y[lead] == 0) {
+        ++lead;
+    }
+    if (lead == n) {
+        return;
+    }
+
+    // Start from 2^ceil(bits / 2) >= sqrt(y); from above, Newton's
+    // x' = (x + y / x) / 2 decreases strictly until x = floor(sqrt(y)).
+    const int32 bits = 64 * (n - lead) - __builtin_clzll(y[lead]);
+    const int32 bit = (bits + 1) / 2;
+    root[n - 1 - bit / 64] = 1ULL << (bit % 64);
+
+    uint64 *rem = work;
+    uint64 *next = work + n;
+    uint64 *divWork = work + 2 * n;
+    for (;;) {
+        memcpy(rem, y, static_cast<size_t>(n) * sizeof(uint64));
+        divideMagnitudes(rem, n, root, n, next, divWork);
+
+        // next = (next + root) / 2, with the carry shifted back in.
+        unsigned char carry = 0;
+        for (int32 i = n - 1; i >= 0; --i) {
+            carry = addWithCarry(next[i], root[i], carry);
+        }
+        for (int32 i = n - 1; i >= 0; --i) {
+            const uint64 above = i > 0 ? next[i - 1] : carry;
+            next[i] = (next[i] >> 1) | (above << 63);
+        }
+
+        if (compareWords(next, root, n) >= 0) {
+            return;
+        }
+        memcpy(root, next, static_cast<size_t>(n) * sizeof(uint64));
+    }
+}
+
+// out = (neg ? -mag : mag) for a magnitude of n >= out.nwds words, when
+// mag < limit = 10^p_out (out.nwds words). Returns false, leaving out
+// untouched, when it does not fit.
+static bool storeMagnitude(const uint64 *mag, int32 n, bool neg,
+                           const uint64 *limit, VNumeric &out)
+{
+    const int32 outWords = out.nwds;
+    const int32 skip = n - outWords;
+    for (int32 i = 0; i < skip; ++i) {
+        if (mag[i] != 0) {
+            return false;
+        }
+    }
+    if (compareWords(mag + skip, limit, outWords) >= 0) {
+        return false;
+    }
+
+    memcpy(out.words, mag + skip, static_cast<size_t>(outWords) * sizeof(uint64));
+    if (neg) {
+        negateWords(out.words, outWords);
+    }
+    return true;
+}
+
+/*
+ * lanes (2 n carry-save words, MSW first, see flushLanes()) += a^2 for a
+ * of n words, a column at a time (Comba's product scanning): column t
+ * (words from the LSW) sums a_i a_j over i + j = t, each cross product
+ * once and doubled, in registers, and its three words go into the lanes at
+ * t, t + 1 and t + 2 with no carry between columns. A row adds at most
+ * three words to a lane, so lanes cannot overflow before 2^62 rows.
+ */
+static inline void accumulateSquare(unsigned __int128 *lanes, const uint64 *a,
+                                    int32 n)
+{
+    const uint64 *lsw = a + (n - 1); // a_i = lsw[-i]
+    unsigned __int128 *lane = lanes + (2 * n - 1);
+    for (int32 t = 0; t < 2 * n - 1; ++t) {
+        int32 i = t < n ? 0 : t - n + 1;
+        int32 j = t - i;
+        unsigned __int128 column = 0;
+        uint64 columnHigh = 0;
+        for (; i < j; ++i, --j) {
+            const unsigned __int128 p =
+                static_cast<unsigned __int128>(lsw[-i]) * lsw[-j];
+            column += p;
+            columnHigh += column < p;
+        }
+        columnHigh = (columnHigh << 1) | static_cast<uint64>(column >> 127);
+        column <<= 1;
+        if (i == j) {
+            const unsigned __int128 p =
+                static_cast<unsigned __int128>(lsw[-i]) * lsw[-i];
+            column += p;
+            columnHigh += column < p;
+        }
+
+        lane[-t] += static_cast<uint64>(column);
+        lane[-t - 1] += static_cast<uint64>(column >> 64);
+        if (t + 2 < 2 * n) {
+            lane[-t - 2] += columnHigh;
+        }
+    }
+}
+
+/*
+ * lanes (an + bn carry-save words) += a * b for a of an words and b of bn
+ * words: accumulateSquare() for two different operands, where each column
+ * sums every a_i b_j with i + j = t.
+ */
+static inline void accumulateProduct(unsigned __int128 *lanes,
+                                     const uint64 *a, int32 an,
+                                     const uint64 *b, int32 bn)
+{
+    const uint64 *aLsw = a + (an - 1);
+    const uint64 *bLsw = b + (bn - 1);
+    unsigned __int128 *lane = lanes + (an + bn - 1);
+    for (int32 t = 0; t < an + bn - 1; ++t) {
+        const int32 first = t < bn ? 0 : t - bn + 1;
+        const int32 last = t < an ? t : an - 1;
+        unsigned __int128 column = 0;
+        uint64 columnHigh = 0;
+        for (int32 i = first; i <= last; ++i) {
+            const unsigned __int128 p =
+                static_cast<unsigned __int128>(aLsw[-i]) * bLsw[i - t];
+            column += p;
+            columnHigh += column < p;
+        }
+
+        lane[-t] += static_cast<uint64>(column);
+        lane[-t - 1] += static_cast<uint64>(column >> 64);
+        if (t + 2 < an + bn) {
+            lane[-t - 2] += columnHigh;
+        }
+    }
+}
+
+// mag = |a| over Words words, without a branch on the sign, which is
+// unpredictable. Returns the sign as a mask: ~0 for negative a, else 0.
+template <int Words>
+static inline uint64 absoluteWords(uint64 *mag, const uint64 *a)
+{
+    const uint64 sign = 0 - (a[0] >> 63);
+    unsigned char carry = static_cast<unsigned char>(sign & 1);
+    for (int32 i = Words - 1; i >= 0; --i) {
+        mag[i] = a[i] ^ sign;
+        carry = addWithCarry(mag[i], 0, carry);
+    }
+    return sign;
+}
+
+// Leading zero words of a magnitude, at most Words - 1, so that products
+// skip them; 0 below SIGN_MAGNITUDE_MIN_WORDS, where the unrolled loops
+// over all Words are cheaper than the scan.
+template <int Words>
+static inline int32 leadingZeroWords(const uint64 *mag)
+{
+    int32 lead = 0;
+    if (Words >= SIGN_MAGNITUDE_MIN_WORDS) {
+        while (lead < Words - 1 && mag[lead] == 0) {
+            ++lead;
+        }
+    }
+    return lead;
+}
+
+/*
+ * Adds every non-NULL NUMERIC a of a block (Words words each) into SUM(a)
+ * and SUM(a^2), carry-save like CarrySaveBlock: a's words go into
+ * sumLanes (negative a only counted) and |a|'s square into 2 Words
+ * sqLanes, which the caller flushes once per block. Returns the rows added.
+ *
+ * Below SIGN_MAGNITUDE_MIN_WORDS the square is taken over all Words, with
+ * the loops unrolled; wider values are squared without their leading zero
+ * words, which are most of them when the data is narrower than the
+ * declared precision. Either way every lane above SUM(a^2)'s width stays
+ * zero: a^2 < 10^(2 p_in) fits SUM(a^2), so if its top lane is within
+ * 2 m - 1 words of a^2's (m words from |a|'s first non-zero one),
+ * |a| < 2^(64 m - 32) and that lane's only term, |a|'s top word squared,
+ * is below 2^64.
+ */
+template <int Words>
+struct SquareSumBlock
+{
+    typedef vint (*Fn)(BlockReader &argReader, unsigned __int128 *sumLanes,
+                       unsigned __int128 *sqLanes, uint64 &negatives);
+
+    static vint run(BlockReader &argReader, unsigned __int128 *sumLanes,
+                    unsigned __int128 *sqLanes, uint64 &negatives)
+    {
+        uint64 magnitude[Words];
+        vint rows = 0;
+
+        do {
+            const VNumeric &input = argReader.getNumericRef(0);
+            if (input.isNull()) {
+                continue;
+            }
+            LaneChain<Words - 1>::add(sumLanes, input.words, 0);
+            negatives += input.words[0] >> 63;
+            rows++;
+
+            absoluteWords<Words>(magnitude, input.words);
+            const int32 lead = leadingZeroWords<Words>(magnitude);
+            accumulateSquare(sqLanes + 2 * lead, magnitude + lead, Words - lead);
+        } while (argReader.next());
+
+        return rows;
+    }
+};
+
+/*
+ * Exact variance and standard deviation (ExactVarPopFactory,
+ * ExactVarSampFactory, ExactStddevFactory):
+ *
+ *   exact_var_pop(a)  = (n * SUM(a^2) - SUM(a)^2) / n^2
+ *   exact_var_samp(a) = (n * SUM(a^2) - SUM(a)^2) / (n * (n - 1))
+ *   exact_stddev(a)   = sqrt(exact_var_samp(a))
+ *
+ * VARIANCE() and STDDEV() work in FLOAT, where n * SUM(a^2) - SUM(a)^2
+ * cancels catastrophically once the mean is large relative to the spread.
+ * Here SUM(a) and SUM(a^2) are exact integers at scales s_in and 2 s_in,
+ * sized like exact_avg's SUM for max_rows rows (p_in + 19 and
+ * 2 p_in + 19 digits by default, as a VARBINARY past 1024), combine()
+ * adds them exactly, and terminate() computes the numerator exactly and
+ * rounds once, half up, when dividing (and, for exact_stddev, once more
+ * exactly when taking the integer square root of four times the scaled
+ * quotient, which yields the correctly rounded root).
+ *
+ * The result is NUMERIC with one integer digit more than a square (or, for
+ * exact_stddev, than the input) of the input type, since VAR_SAMP of two
+ * values +/-M is 2 M^2:
+ *   exact_var_*:  p_out = min(1024, 2 p_in + 5), s_out = p_out - (2 (p_in - s_in) + 1)
+ *   exact_stddev: p_out = min(1024, p_in + 5),   s_out = p_out - (p_in - s_in + 1)
+ * with s_out clamped to >= 0. A result that still does not fit (possible
+ * only when p_out is clamped) is an error, like exact_avg's. No rows give
+ * NULL, as does a single row for exact_var_samp and exact_stddev.
+ */
+enum MomentKind { VAR_POP, VAR_SAMP, STDDEV_SAMP };
+
+static const char *momentName(MomentKind kind)
+{
+    return kind == VAR_POP ? "exact_var_pop"
+         : kind == VAR_SAMP ? "exact_var_samp" : "exact_stddev";
+}
+
+// Adds the NUMERIC result type of a moment aggregate of inType (see above).
+static void addMomentType(const VerticaType &inType, MomentKind kind,
+                          SizedColumnTypes &outputTypes)
+{
+    int32 p_in;
+    int32 s_in;
+    inputPrecisionScale(inType, momentName(kind), p_in, s_in);
+
+    const bool squared = kind != STDDEV_SAMP;
+    int32 p_out = (squared ? 2 * p_in : p_in) + AVG_EXTRA_DIGITS;
+    if (p_out > MAX_NUMERIC_PRECISION) {
+        p_out = MAX_NUMERIC_PRECISION;
+    }
+
+    const int32 intDigits = (squared ? 2 * (p_in - s_in) : p_in - s_in) + 1;
+    int32 s_out = p_out - intDigits;
+    if (s_out < 0) {
+        s_out = 0;
+    }
+
+    outputTypes.addNumeric(p_out, s_out, momentName(kind));
+}
+
+// Adds an exact SUM of p_sum digits at scale s to intermediateTypes: a
+// NUMERIC, or past 1024 digits a VARBINARY of the same words.
+static void addSumType(int32 p_sum, int32 s, const char *name,
+                       SizedColumnTypes &intermediateTypes)
+{
+    if (p_sum > MAX_NUMERIC_PRECISION) {
+        intermediateTypes.addVarbinary(sumWordsFor(p_sum) * sizeof(uint64), name);
+    } else {
+        intermediateTypes.addNumeric(p_sum, s < p_sum ? s : p_sum, name);
+    }
+}
+
+class ExactVariance : public AggregateFunction
+{
+public:
+    explicit ExactVariance(MomentKind kind)
+        : kind(kind), inWords(0), s_in(0), sumLen(0), sqLen(0), wideSum(false),
+          wideSq(false), useInt128Lane(false), blockKernel(0), sqLaneLen(0),
+          lanes(0),
+          maxRows(MAX_ROW_COUNT), scaleUp(0), scaleDown(0), numLen(0),
+          denLen(0), limit(0), magnitude(0), square(0), num(0), den(0),
+          quotient(0), root(0), work(0)
+    {}
+
+    InlineAggregate()
+
+    // Size both SUMs and the result from the input type, and allocate the
+    // per-row and terminate() scratch once per function instance.
+    virtual void setup(ServerInterface &srvInterface,
+                       const SizedColumnTypes &argTypes)
+    {
+        const VerticaType &inType = argTypes.getColumnType(0);
+        int32 p_in;
+        inputPrecisionScale(inType, momentName(kind), p_in, s_in);
+        inWords = inType.getNumericWordCount();
+        maxRows = maxRowsParameter(srvInterface, momentName(kind));
+
+        const int32 rowDigits = rowCountDigitsFor(maxRows);
+        const int32 p_sum = sumPrecisionFor(p_in, rowDigits);
+        const int32 p_sq = sumPrecisionFor(2 * p_in, rowDigits);
+        wideSum = p_sum > MAX_NUMERIC_PRECISION;
+        wideSq = p_sq > MAX_NUMERIC_PRECISION;
+        sumLen = sumWordsFor(p_sum);
+        sqLen = sumWordsFor(p_sq);
+        sumColumn.setup(srvInterface, 0, sumLen, wideSum);
+        sqColumn.setup(srvInterface, 1, sqLen, wideSq);
+        useInt128Lane = p_in <= MAX_INT128_LANE_PRECISION && sumLen >= 2;
+        blockKernel = KernelPicker<SquareSumBlock, MAX_NUMERIC_WORDS>::pick(inWords);
+
+        // Carry-save lanes for blockKernel: inWords for SUM(a), then one per
+        // word of a^2, of which the last sqLaneLen (as many as SUM(a^2)
+        // has) are flushed.
+        sqLaneLen = 2 * inWords < sqLen ? 2 * inWords : sqLen;
+        const size_t laneBytes =
+            static_cast<size_t>(3 * inWords) * sizeof(unsigned __int128);
+        lanes = static_cast<unsigned __int128 *>(
+            srvInterface.allocator->alloc(laneBytes));
+        memset(lanes, 0, laneBytes);
+
+        // The numerator n * SUM(a^2) - SUM(a)^2 is at scale 2 s_in (the
+        // square root halves it); scaleUp or scaleDown powers of ten bring
+        // the quotient to the result scale.
+        SizedColumnTypes outTypes;
+        addMomentType(inType, kind, outTypes);
+        const VerticaType &outType = outTypes.getColumnType(0);
+        const int32 s_out = outType.getNumericScale();
+        const int32 shift = kind == STDDEV_SAMP
+            ? 2 * (s_out - s_in) : s_out - 2 * s_in;
+        scaleUp = shift > 0 ? shift : 0;
+        scaleDown = shift < 0 ? -shift : 0;
+
+        const int32 outWords = outType.getNumericWordCount();
+        limit = allocWords(srvInterface, outWords);
+        powerOfTen(limit, outWords, outType.getNumericPrecision());
+
+        // n * SUM(a^2) takes a word more than SUM(a^2), SUM(a)^2 twice
+        // SUM(a)'s words, and the scaling (at most 4 * 10^8) one more.
+        numLen = (sqLen + 1 > 2 * sumLen ? sqLen + 1 : 2 * sumLen) + 1;
+        denLen = sumWordsFor(scaleDown) + 2;
+        magnitude = allocWords(srvInterface, sumLen);
+        square = allocWords(srvInterface, 2 * sumLen);
+        num = allocWords(srvInterface, numLen);
+        den = allocWords(srvInterface, denLen);
+        quotient = allocWords(srvInterface, numLen);
+        root = allocWords(srvInterface, numLen);
+        work = allocWords(srvInterface, 5 * numLen + denLen + 1);
+    }
+
+    // sum = sumsq = 0, cnt = 0
+    virtual void initAggregate(ServerInterface &srvInterface,
+                               IntermediateAggs &aggs)
+    {
+        try {
+            sumColumn.clear(aggs);
+            sqColumn.clear(aggs);
+            aggs.getIntRef(2) = 0;
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in initAggregate: [%s]",
+                            momentName(kind), e.what());
+        }
+    }
+
+    // sum += a, sumsq += a^2 and cnt += 1 for every non-NULL a.
+    virtual void aggregate(ServerInterface &srvInterface,
+                           BlockReader &argReader,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            uint64 *sum = sumColumn.load(aggs);
+            uint64 *sumSq = sqColumn.load(aggs);
+            vint &cnt = aggs.getIntRef(2);
+            cnt += useInt128Lane
+                ? aggregateInt128(argReader, sum, sumSq)
+                : aggregateWords(argReader, sum, sumSq);
+            checkRowCount(cnt);
+            sumColumn.store(aggs);
+            sqColumn.store(aggs);
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in aggregate: [%s]",
+                            momentName(kind), e.what());
+        }
+    }
+
+    // Both SUMs are exact integers of a fixed width, so partials just add.
+    virtual void combine(ServerInterface &srvInterface,
+                         IntermediateAggs &aggs,
+                         MultipleIntermediateAggs &aggsOther)
+    {
+        try {
+            uint64 *sum = sumColumn.load(aggs);
+            uint64 *sumSq = sqColumn.load(aggs);
+            vint &cnt = aggs.getIntRef(2);
+            do {
+                addWords(sum, sumColumn.loadOther(aggsOther), sumLen);
+                addWords(sumSq, sqColumn.loadOther(aggsOther), sqLen);
+                cnt += aggsOther.getIntRef(2);
+            } while (aggsOther.next());
+            checkRowCount(cnt);
+            sumColumn.store(aggs);
+            sqColumn.store(aggs);
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in combine: [%s]",
+                            momentName(kind), e.what());
+        }
+    }
+
+    virtual void terminate(ServerInterface &srvInterface,
+                           BlockWriter &resWriter,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            const vint rowCount = aggs.getIntRef(2);
+            if (rowCount < 0) {
+                vt_report_error(0,
+                    "%s: internal error: negative row count %lld",
+                    momentName(kind), static_cast<long long>(rowCount));
+            }
+            VNumeric &out = resWriter.getNumericRef(0);
+            if (rowCount == 0 || (rowCount == 1 && kind != VAR_POP)) {
+                out.setNull();
+                return;
+            }
+            const uint64 n = static_cast<uint64>(rowCount);
+
+            // num = n * SUM(a^2) - SUM(a)^2, which is >= 0 (Cauchy-Schwarz).
+            const uint64 *sum = sumColumn.load(aggs);
+            memset(num, 0, static_cast<size_t>(numLen - sqLen) * sizeof(uint64));
+            memcpy(num + (numLen - sqLen), sqColumn.load(aggs),
+                   static_cast<size_t>(sqLen) * sizeof(uint64));
+            multiplyWords(num, numLen, n);
+            memcpy(magnitude, sum, static_cast<size_t>(sumLen) * sizeof(uint64));
+            if (static_cast<int64>(magnitude[0]) < 0) {
+                negateWords(magnitude, sumLen);
+            }
+            multiplyMagnitudes(magnitude, sumLen, magnitude, sumLen, square);
+            subtractMagnitude(num, numLen, square, 2 * sumLen);
+            multiplyWords(num, numLen, kind == STDDEV_SAMP
+                ? 4 * POW10[scaleUp] : POW10[scaleUp]);
+
+            // den = n^2 or n (n - 1), times 10^scaleDown.
+            const unsigned __int128 divisor =
+                static_cast<unsigned __int128>(n) * (kind == VAR_POP ? n : n - 1);
+            const uint64 divisorWords[2] = {
+                static_cast<uint64>(divisor >> 64), static_cast<uint64>(divisor) };
+            powerOfTen(work, denLen - 2, scaleDown);
+            multiplyMagnitudes(work, denLen - 2, divisorWords, 2, den);
+
+            const uint64 *result = quotient;
+            if (kind == STDDEV_SAMP) {
+                // round(sqrt(x)) = (floor(sqrt(floor(4 x))) + 1) / 2
+                divideMagnitudes(num, numLen, den, denLen, quotient, work);
+                squareRoot(quotient, numLen, root, work);
+                const uint64 one = 1;
+                addMagnitude(root, numLen, &one, 1);
+                divideWords(root, numLen, 2);
+                result = root;
+            } else {
+                roundedQuotient(num, numLen, den, denLen, quotient, work);
+            }
+
+            if (!storeMagnitude(result, numLen, false, limit, out)) {
+                vt_report_error(0,
+                    "%s: the result does not fit in the result type "
+                    "NUMERIC(%d, %d)",
+                    momentName(kind), out.getPrecision(), out.getScale());
+            }
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in terminate: [%s]",
+                            momentName(kind), e.what());
+        }
+    }
+
+private:
+    // Which of the three aggregates this is.
+    MomentKind kind;
+
+    // Words and scale of the NUMERIC input.
+    int32 inWords;
+    int32 s_in;
+
+    // Words in SUM(a) and SUM(a^2), whether each lives in a VARBINARY
+    // (more than 1024 digits) rather than a NUMERIC, and access to each.
+    int32 sumLen;
+    int32 sqLen;
+    bool wideSum;
+    bool wideSq;
+    SumColumn sumColumn;
+    SumColumn sqColumn;
+
+    // True for NUMERIC(p <= 18) with a SUM of at least two words: one int64
+    // word per value, summed and squared in native 128-bit arithmetic.
+    bool useInt128Lane;
+
+    // SquareSumBlock<N> for the input's word count N.
+    SquareSumBlock<1>::Fn blockKernel;
+
+    // blockKernel's lanes: inWords for SUM(a), then 2 inWords for a^2, of
+    // which SUM(a^2) takes the last sqLaneLen. flushLanes() leaves them
+    // cleared for the next block.
+    int32 sqLaneLen;
+    unsigned __int128 *lanes;
+
+    // The max_rows parameter; both SUMs only have room for this many rows.
+    vint maxRows;
+
+    // Powers of ten between the numerator's scale and the result's; at
+    // most one of them is non-zero.
+    int32 scaleUp;
+    int32 scaleDown;
+
+    // Words in terminate()'s numerator (and quotient) and divisor.
+    int32 numLen;
+    int32 denLen;
+
+    // 10^p_out, which the result's magnitude must stay below.
+    uint64 *limit;
+
+    // terminate()'s scratch, allocated in setup(): |SUM(a)|, SUM(a)^2, the
+    // numerator, divisor, quotient, square root and division workspace.
+    uint64 *magnitude;
+    uint64 *square;
+    uint64 *num;
+    uint64 *den;
+    uint64 *quotient;
+    uint64 *root;
+    uint64 *work;
+
+    static uint64 *allocWords(ServerInterface &srvInterface, int32 n)
+    {
+        return static_cast<uint64 *>(srvInterface.allocator->alloc(
+            static_cast<size_t>(n) * sizeof(uint64)));
+    }
+
+    void checkRowCount(vint cnt) const
+    {
+        if (cnt > maxRows) {
+            vt_report_error(0,
+                "%s: a group has more than max_rows = %lld non-NULL rows; "
+                "raise max_rows or omit it",
+                momentName(kind), static_cast<long long>(maxRows));
+        }
+    }
+
+    /*
+     * NUMERIC(p_in <= 18): each value is one int64 word and its square is
+     * below 10^36 < 2^120. The block's SUM(a) is kept in an __int128 (as
+     * in ExactAvg::aggregateInt128()) and its SUM(a^2) in an unsigned
+     * __int128 plus a word that counts its carries, and both are added to
+     * the group's SUMs once per block.
+     */
+    vint aggregateInt128(BlockReader &argReader, uint64 *sum,
+                         uint64 *sumSq) const
+    {
+        __int128 total = 0;
+        unsigned __int128 squares = 0;
+        uint64 squaresHigh = 0;
+        vint rows = 0;
+
+        do {
+            const int64 value =
+                static_cast<int64>(argReader.getNumericRef(0).words[0]);
+            if (value != vint_null) {
+                const uint64 mag = value < 0
+                    ? 0 - static_cast<uint64>(value) : static_cast<uint64>(value);
+                const unsigned __int128 sq =
+                    static_cast<unsigned __int128>(mag) * mag;
+                total += value;
+                squares += sq;
+                squaresHigh += squares < sq;
+                rows++;
+            }
+        } while (argReader.next());
+
+        accumulateInt128(sum, sumLen, total);
+        const uint64 words[3] = { squaresHigh,
+                                  static_cast<uint64>(squares >> 64),
+                                  static_cast<uint64>(squares) };
+        addMagnitude(sumSq, sqLen, words, 3);
+        return rows;
+    }
+
+    // Wider inputs: SquareSumBlock, flushed into the SUMs once per block.
+    vint aggregateWords(BlockReader &argReader, uint64 *sum,
+                        uint64 *sumSq) const
+    {
+        unsigned __int128 *sumLanes = lanes;
+        unsigned __int128 *sqLanes = lanes + inWords;
+        uint64 negatives = 0;
+        const vint rows = blockKernel(argReader, sumLanes, sqLanes, negatives);
+
+        flushLanes(sum, sumLen, sumLanes, inWords, negatives);
+        flushLanes(sumSq, sqLen, sqLanes + (2 * inWords - sqLaneLen),
+                   sqLaneLen, 0);
+        return rows;
+    }
+};
+
+/**
+ * Factory for exact_var_pop; exact_var_samp and exact_stddev differ only in
+ * the MomentKind they pass. One NUMERIC argument, with the intermediate
+ * (sum, sumsq, cnt) types sized like ExactAvgFactory's SUM.
+ */
+class ExactVarianceFactory : public AggregateFunctionFactory
+{
+public:
+    explicit ExactVarianceFactory(MomentKind kind = VAR_POP) : kind(kind) {}
+
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addNumeric();
+        returnType.addNumeric();
+    }
+
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
+    {
+        checkArguments(inputTypes);
+        addMomentType(inputTypes.getColumnType(0), kind, outputTypes);
+    }
+
+    // sum:   NUMERIC(p_in + 19, s_in), as exact_avg's SUM
+    // sumsq: NUMERIC(2 p_in + 19, 2 s_in), the squares' SUM
+    // cnt:   INTEGER
+    // with fewer digits under max_rows, and a VARBINARY past 1024 digits.
+    virtual void getIntermediateTypes(ServerInterface &srvInterface,
+                                      const SizedColumnTypes &inputTypes,
+                                      SizedColumnTypes &intermediateTypes)
+    {
+        checkArguments(inputTypes);
+
+        int32 p_in;
+        int32 s_in;
+        inputPrecisionScale(inputTypes.getColumnType(0), momentName(kind), p_in,
+                            s_in);
+        const int32 rowDigits =
+            rowCountDigitsFor(maxRowsParameter(srvInterface, momentName(kind)));
+
+        addSumType(sumPrecisionFor(p_in, rowDigits), s_in, "sum",
+                   intermediateTypes);                          // index 0
+        addSumType(sumPrecisionFor(2 * p_in, rowDigits), 2 * s_in, "sumsq",
+                   intermediateTypes);                          // index 1
+        intermediateTypes.addInt("cnt");                        // index 2
+    }
+
+    // Optional: max_rows, as for exact_avg.
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes)
+    {
+        parameterTypes.addInt("max_rows");
+    }
+
+    virtual AggregateFunction *createAggregateFunction(
+        ServerInterface &srvInterface)
+    {
+        return vt_createFuncObject<ExactVariance>(srvInterface.allocator, kind);
+    }
+
+private:
+    MomentKind kind;
+
+    void checkArguments(const SizedColumnTypes &inputTypes) const
+    {
+        if (inputTypes.getColumnCount() != 1 ||
+            !inputTypes.getColumnType(0).isNumeric()) {
+            vt_report_error(0,
+                "%s expects exactly one NUMERIC argument", momentName(kind));
+        }
+    }
+};
+
+class ExactVarPopFactory : public ExactVarianceFactory
+{
+public:
+    ExactVarPopFactory() : ExactVarianceFactory(VAR_POP) {}
+};
+
+class ExactVarSampFactory : public ExactVarianceFactory
+{
+public:
+    ExactVarSampFactory() : ExactVarianceFactory(VAR_SAMP) {}
+};
+
+class ExactStddevFactory : public ExactVarianceFactory
+{
+public:
+    ExactStddevFactory() : ExactVarianceFactory(STDDEV_SAMP) {}
+};
+
+RegisterFactory(ExactVarPopFactory);
+RegisterFactory(ExactVarSampFactory);
+RegisterFactory(ExactStddevFactory);
+
+/*
+ * Exact covariance, correlation and regression slope over pairs of NUMERIC
+ * columns (ExactCovarPopFactory, ExactCorrFactory, ExactRegrSlopeFactory):
+ *
+ *   exact_covar_pop(y, x)  = Cxy / n^2
+ *   exact_corr(y, x)       = Cxy / sqrt(Cxx * Cyy)
+ *   exact_regr_slope(y, x) = Cxy / Cxx
+ *
+ * with Cab = n * SUM(a * b) - SUM(a) * SUM(b), matching COVAR_POP, CORR and
+ * REGR_SLOPE (y is the dependent variable). Pairs where either value is
+ * NULL are skipped. A single pass keeps SUM(y), SUM(x) and SUM(x * y) and,
+ * when the aggregate needs them, SUM(x^2) (exact_corr, exact_regr_slope)
+ * and SUM(y^2) (exact_corr). Each is an exact integer sized like
+ * exact_avg's SUM: p + 19 digits by default, where p is p_y, p_x,
+ * p_x + p_y, 2 p_x or 2 p_y. terminate() rounds once, half up; exact_corr
+ * goes through the integer square root, as exact_stddev does.
+ *
+ * Result types, with s_out = p_out - intDigits clamped to >= 0:
+ *   exact_covar_pop:  p_out = min(1024, p_x + p_y + 5),
+ *                     intDigits = (p_x - s_x) + (p_y - s_y) + 1
+ *   exact_corr:       p_out = min(1024, max(p_x, p_y) + 5), intDigits = 1
+ *   exact_regr_slope: intDigits = (p_y - s_y) + s_x + d / 2 + 1,
+ *                     p_out = min(1024, intDigits + s_y + (p_x - s_x) + 5)
+ * where d is the digits of max_rows (19 by default). The slope is not
+ * bounded by the inputs alone. However, |Cxy| <= sqrt(Cxx Cyy),
+ * Cyy <= 2 n^2 max|y|^2, and Cxx >= (n - 1) 10^(-2 s_x) when the x are not
+ * all equal, so |slope| < sqrt(2 n) max|y| 10^s_x. Its scale keeps five
+ * digits of a slope of one unit of y across all of x's range. No pairs
+ * give NULL, as do Cxx = 0 for exact_regr_slope (x constant, or one pair)
+ * and Cxx = 0 or Cyy = 0 for exact_corr.
+ */
+enum PairKind { COVAR_POP, CORR, REGR_SLOPE };
+
+// The SUMs of a pair aggregate, in intermediate column order; cnt follows
+// the last one the aggregate keeps.
+enum PairSum { SUM_Y, SUM_X, SUM_XY, SUM_XX, SUM_YY, MAX_PAIR_SUMS };
+
+static const char *const PAIR_SUM_NAMES[MAX_PAIR_SUMS] = {
+    "sumy", "sumx", "sumxy", "sumxx", "sumyy"
+};
+
+static const char *pairName(PairKind kind)
+{
+    return kind == COVAR_POP ? "exact_covar_pop"
+         : kind == CORR ? "exact_corr" : "exact_regr_slope";
+}
+
+// Precision and scale of each SUM a pair aggregate of (y, x) keeps, sized
+// for maxRows rows; returns how many it keeps.
+static int32 pairSumTypes(const SizedColumnTypes &argTypes, PairKind kind,
+                          vint maxRows, int32 *p_sum, int32 *s_sum)
+{
+    int32 p_y;
+    int32 s_y;
+    int32 p_x;
+    int32 s_x;
+    inputPrecisionScale(argTypes.getColumnType(0), pairName(kind), p_y, s_y);
+    inputPrecisionScale(argTypes.getColumnType(1), pairName(kind), p_x, s_x);
+    const int32 rowDigits = rowCountDigitsFor(maxRows);
+
+    p_sum[SUM_Y] = sumPrecisionFor(p_y, rowDigits);
+    s_sum[SUM_Y] = s_y;
+    p_sum[SUM_X] = sumPrecisionFor(p_x, rowDigits);
+    s_sum[SUM_X] = s_x;
+    p_sum[SUM_XY] = sumPrecisionFor(p_x + p_y, rowDigits);
+    s_sum[SUM_XY] = s_x + s_y;
+    p_sum[SUM_XX] = sumPrecisionFor(2 * p_x, rowDigits);
+    s_sum[SUM_XX] = 2 * s_x;
+    p_sum[SUM_YY] = sumPrecisionFor(2 * p_y, rowDigits);
+    s_sum[SUM_YY] = 2 * s_y;
+
+    return kind == COVAR_POP ? SUM_XX : kind == REGR_SLOPE ? SUM_YY
+                                                           : MAX_PAIR_SUMS;
+}
+
+// Adds the NUMERIC result type of a pair aggregate of (y, x) (see above).
+static void addPairType(const SizedColumnTypes &argTypes, PairKind kind,
+                        vint maxRows, SizedColumnTypes &outputTypes)
+{
+    int32 p_y;
+    int32 s_y;
+    int32 p_x;
+    int32 s_x;
+    inputPrecisionScale(argTypes.getColumnType(0), pairName(kind), p_y, s_y);
+    inputPrecisionScale(argTypes.getColumnType(1), pairName(kind), p_x, s_x);
+
+    int32 p_out;
+    int32 intDigits;
+    if (kind == COVAR_POP) {
+        p_out = p_x + p_y + AVG_EXTRA_DIGITS;
+        intDigits = (p_x - s_x) + (p_y - s_y) + 1;
+    } else if (kind == CORR) {
+        p_out = (p_x > p_y ? p_x : p_y) + AVG_EXTRA_DIGITS;
+        intDigits = 1;
+    } else {
+        intDigits = (p_y - s_y) + s_x + rowCountDigitsFor(maxRows) / 2 + 1;
+        p_out = intDigits + s_y + (p_x - s_x) + AVG_EXTRA_DIGITS;
+    }
+    if (p_out > MAX_NUMERIC_PRECISION) {
+        p_out = MAX_NUMERIC_PRECISION;
+    }
+
+    int32 s_out = p_out - intDigits;
+    if (s_out < 0) {
+        s_out = 0;
+    }
+
+    outputTypes.addNumeric(p_out, s_out, pairName(kind));
+}
+
+// dst (dn words) += src (sn words), both two's complement and aligned on
+// the least significant word; src is sign-extended, or truncated, to dn.
+static void addSignedWords(uint64 *dst, int32 dn, const uint64 *src,
+                           int32 sn)
+{
+    const uint64 ext = static_cast<int64>(src[0]) < 0 ? ~0ULL : 0ULL;
+    unsigned char carry = 0;
+    for (int32 i = dn - 1, j = sn - 1; i >= 0; --i, --j) {
+        carry = addWithCarry(dst[i], j >= 0 ? src[j] : ext, carry);
+    }
+}
+
+static bool isZeroWords(const uint64 *u, int32 n)
+{
+    for (int32 i = 0; i < n; ++i) {
+        if (u[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * out (outLen words) = n * sumAB - sumA * sumB, all two's complement.
+ * outLen must hold both terms with a sign bit to spare; the arithmetic is
+ * modulo 2^(64 outLen), so the order of the terms does not matter. scratch
+ * holds 2 (aLen + bLen) words.
+ */
+static void crossMoment(uint64 *out, int32 outLen, uint64 n,
+                        const uint64 *sumAB, int32 abLen,
+                        const uint64 *sumA, int32 aLen,
+                        const uint64 *sumB, int32 bLen, uint64 *scratch)
+{
+    memset(out, 0, static_cast<size_t>(outLen) * sizeof(uint64));
+    addSignedWords(out, outLen, sumAB, abLen);
+    multiplyWords(out, outLen, n);
+
+    uint64 *a = scratch;
+    uint64 *b = scratch + aLen;
+    uint64 *product = scratch + aLen + bLen;
+    memcpy(a, sumA, static_cast<size_t>(aLen) * sizeof(uint64));
+    memcpy(b, sumB, static_cast<size_t>(bLen) * sizeof(uint64));
+    const bool negA = static_cast<int64>(a[0]) < 0;
+    const bool negB = static_cast<int64>(b[0]) < 0;
+    if (negA) {
+        negateWords(a, aLen);
+    }
+    if (negB) {
+        negateWords(b, bLen);
+    }
+    multiplyMagnitudes(a, aLen, b, bLen, product);
+    if (negA != negB) {
+        addMagnitude(out, outLen, product, aLen + bLen);
+    } else {
+        subtractMagnitude(out, outLen, product, aLen + bLen);
+    }
+}
+
+/*
+ * CrossMomentBlock's carry-save lanes, MSW first (see flushLanes()):
+ * Words each for SUM(y) and SUM(x), with their negative inputs counted,
+ * and 2 Words for each product. |x y| goes into xyNegative rather than
+ * xyPositive when the signs differ, so that SUM(x * y) is the difference
+ * of two sums of magnitudes. y, xx and yy are null when the aggregate
+ * does not keep SUM(y), SUM(x^2) or SUM(y^2).
+ */
+struct PairLanes
+{
+    unsigned __int128 *y;
+    unsigned __int128 *x;
+    unsigned __int128 *xyPositive;
+    unsigned __int128 *xyNegative;
+    unsigned __int128 *xx;
+    unsigned __int128 *yy;
+    uint64 yNegatives;
+    uint64 xNegatives;
+};
+
+// dst (Words words) = src (n <= Words words), sign-extended.
+template <int Words>
+static inline void widenWords(uint64 *dst, const uint64 *src, int32 n)
+{
+    const uint64 ext = 0 - (src[0] >> 63);
+    for (int32 i = 0; i < Words - n; ++i) {
+        dst[i] = ext;
+    }
+    memcpy(dst + (Words - n), src, static_cast<size_t>(n) * sizeof(uint64));
+}
+
+/*
+ * Adds every (y, x) of a block where neither is NULL into the lanes and
+ * returns the pairs added. Both values are widened to Words, the wider
+ * input's word count, so one instantiation per width covers every pair of
+ * input types. As in SquareSumBlock, the products skip the magnitudes'
+ * leading zero words.
+ *
+ * The caller flushes only as many of each SUM's lowest lanes as the SUM
+ * has words. The SUM fits, so it is exact modulo 2^(64 words). For the
+ * products, the lanes above the SUM only ever receive zeros, since each
+ * product's columns are non-negative and at most the product itself.
+ */
+template <int Words>
+struct CrossMomentBlock
+{
+    typedef vint (*Fn)(BlockReader &argReader, int32 yWords, int32 xWords,
+                       PairLanes &lanes);
+
+    static vint run(BlockReader &argReader, int32 yWords, int32 xWords,
+                    PairLanes &lanes)
+    {
+        uint64 y[Words];
+        uint64 x[Words];
+        uint64 yMag[Words];
+        uint64 xMag[Words];
+        vint rows = 0;
+
+        do {
+            const VNumeric &yIn = argReader.getNumericRef(0);
+            const VNumeric &xIn = argReader.getNumericRef(1);
+            if (yIn.isNull() || xIn.isNull()) {
+                continue;
+            }
+            widenWords<Words>(y, yIn.words, yWords);
+            widenWords<Words>(x, xIn.words, xWords);
+            if (lanes.y) {
+                LaneChain<Words - 1>::add(lanes.y, y, 0);
+                lanes.yNegatives += y[0] >> 63;
+            }
+            LaneChain<Words - 1>::add(lanes.x, x, 0);
+            lanes.xNegatives += x[0] >> 63;
+            rows++;
+
+            const uint64 ySign = absoluteWords<Words>(yMag, y);
+            const uint64 xSign = absoluteWords<Words>(xMag, x);
+            const int32 yLead = leadingZeroWords<Words>(yMag);
+            const int32 xLead = leadingZeroWords<Words>(xMag);
+            unsigned __int128 *xy =
+                ySign != xSign ? lanes.xyNegative : lanes.xyPositive;
+            accumulateProduct(xy + (yLead + xLead), yMag + yLead, Words - yLead,
+                              xMag + xLead, Words - xLead);
+            if (lanes.xx) {
+                accumulateSquare(lanes.xx + 2 * xLead, xMag + xLead,
+                                 Words - xLead);
+            }
+            if (lanes.yy) {
+                accumulateSquare(lanes.yy + 2 * yLead, yMag + yLead,
+                                 Words - yLead);
+            }
+        } while (argReader.next());
+
+        return rows;
+    }
+};
+
+// flushLanes() of the last min(laneCount, sumWords) lanes; see
+// CrossMomentBlock. A SUM narrower than the lanes (SUM(y) or SUM(x) when
+// the other input is wider) drops the upper lanes, which only hold sign
+// extension; they are cleared too, so every lane starts the next block at
+// zero.
+static void flushLowLanes(uint64 *sum, int32 sumWords,
+                          unsigned __int128 *lanes, int32 laneCount,
+                          uint64 negatives, bool subtract = false)
+{
+    const int32 k = laneCount < sumWords ? laneCount : sumWords;
+    flushLanes(sum, sumWords, lanes + (laneCount - k), k, negatives, subtract);
+    memset(lanes, 0,
+           static_cast<size_t>(laneCount - k) * sizeof(unsigned __int128));
+}
+
+class ExactCovariance : public AggregateFunction
+{
+public:
+    explicit ExactCovariance(PairKind kind)
+        : kind(kind), sums(0), yWords(0), xWords(0), laneWords(0),
+          useInt128Lane(false), blockKernel(0), maxRows(MAX_ROW_COUNT),
+          scaleUp(0), scaleDown(0), cLen(0), aLen(0), bLen(0), mLen(0),
+          baseLen(0), upLen(0), downLen(0), numLen(0), denLen(0), rootLen(0),
+          limit(0), c(0), a(0), b(0), cSquared(0), base(0), power(0), num(0),
+          den(0), quotient(0), root(0), work(0), scratch(0)
+    {
+        memset(sumLen, 0, sizeof(sumLen));
+        memset(&lanes, 0, sizeof(lanes));
+    }
+
+    InlineAggregate()
+
+    // Size the SUMs and the result from the input types, and allocate the
+    // per-block lanes and terminate()'s scratch once per function instance.
+    virtual void setup(ServerInterface &srvInterface,
+                       const SizedColumnTypes &argTypes)
+    {
+        const VerticaType &yType = argTypes.getColumnType(0);
+        const VerticaType &xType = argTypes.getColumnType(1);
+        yWords = yType.getNumericWordCount();
+        xWords = xType.getNumericWordCount();
+        laneWords = yWords > xWords ? yWords : xWords;
+        maxRows = maxRowsParameter(srvInterface, pairName(kind));
+
+        int32 p_sum[MAX_PAIR_SUMS];
+        int32 s_sum[MAX_PAIR_SUMS];
+        sums = pairSumTypes(argTypes, kind, maxRows, p_sum, s_sum);
+        for (int32 i = 0; i < sums; ++i) {
+            sumLen[i] = sumWordsFor(p_sum[i]);
+            sumColumn[i].setup(srvInterface, static_cast<size_t>(i), sumLen[i],
+                               p_sum[i] > MAX_NUMERIC_PRECISION);
+        }
+        useInt128Lane = yType.getNumericPrecision() <= MAX_INT128_LANE_PRECISION &&
+                        xType.getNumericPrecision() <= MAX_INT128_LANE_PRECISION &&
+                        sumLen[SUM_Y] >= 2 && sumLen[SUM_X] >= 2;
+        blockKernel =
+            KernelPicker<CrossMomentBlock, MAX_NUMERIC_WORDS>::pick(laneWords);
+
+        const size_t laneBytes =
+            static_cast<size_t>(10 * laneWords) * sizeof(unsigned __int128);
+        unsigned __int128 *laneBase = static_cast<unsigned __int128 *>(
+            srvInterface.allocator->alloc(laneBytes));
+        memset(laneBase, 0, laneBytes);
+        lanes.y = laneBase;
+        lanes.x = laneBase + laneWords;
+        lanes.xyPositive = laneBase + 2 * laneWords;
+        lanes.xyNegative = laneBase + 4 * laneWords;
+        lanes.xx = sums > SUM_XX ? laneBase + 6 * laneWords : 0;
+        lanes.yy = sums > SUM_YY ? laneBase + 8 * laneWords : 0;
+
+        // Cxy is at scale s_x + s_y, Cxx at 2 s_x; exact_corr squares Cxy
+        // so that the quotient's scale is 2 s_out and its square root's
+        // s_out.
+        SizedColumnTypes outTypes;
+        addPairType(argTypes, kind, maxRows, outTypes);
+        const VerticaType &outType = outTypes.getColumnType(0);
+        const int32 s_out = outType.getNumericScale();
+        const int32 shift = kind == COVAR_POP ? s_out - (s_sum[SUM_X] + s_sum[SUM_Y])
+                          : kind == REGR_SLOPE ? s_out - (s_sum[SUM_Y] - s_sum[SUM_X])
+                          : 2 * s_out;
+        scaleUp = shift > 0 ? shift : 0;
+        scaleDown = shift < 0 ? -shift : 0;
+
+        const int32 outWords = outType.getNumericWordCount();
+        limit = allocWords(srvInterface, outWords);
+        powerOfTen(limit, outWords, outType.getNumericPrecision());
+
+        // Each C takes a word more than n times its product SUM or than
+        // the product of its two SUMs, whichever is longer, plus the sign.
+        cLen = crossLength(SUM_XY, SUM_X, SUM_Y);
+        aLen = sums > SUM_XX ? crossLength(SUM_XX, SUM_X, SUM_X) : 0;
+        bLen = sums > SUM_YY ? crossLength(SUM_YY, SUM_Y, SUM_Y) : 0;
+
+        // terminate() divides num = M 10^scaleUp by den = D 10^scaleDown,
+        // where M is |Cxy| (4 Cxy^2 for exact_corr) and D is n^2, Cxx or
+        // Cxx Cyy; the square root is taken over the quotient's last
+        // rootLen words, since |exact_corr| <= 1.
+        mLen = kind == CORR ? 2 * cLen + 1 : cLen;
+        baseLen = kind == COVAR_POP ? 2 : kind == REGR_SLOPE ? aLen : aLen + bLen;
+        upLen = sumWordsFor(scaleUp);
+        downLen = sumWordsFor(scaleDown);
+        denLen = baseLen + downLen;
+        numLen = mLen + upLen;
+        numLen = numLen > denLen ? numLen : denLen;
+        numLen = numLen > outWords ? numLen : outWords;
+        rootLen = kind == CORR ? sumWordsFor(2 * s_out) + 1 : 0;
+
+        const int32 sumsLen = sumLen[SUM_X] + sumLen[SUM_Y];
+        const int32 squaresLen = 2 * (sumLen[SUM_X] > sumLen[SUM_Y]
+                                      ? sumLen[SUM_X] : sumLen[SUM_Y]);
+        const int32 workLen = numLen + denLen + 1;
+        c = allocWords(srvInterface, cLen);
+        a = allocWords(srvInterface, aLen > 0 ? aLen : 1);
+        b = allocWords(srvInterface, bLen > 0 ? bLen : 1);
+        cSquared = allocWords(srvInterface, kind == CORR ? mLen : 1);
+        base = allocWords(srvInterface, baseLen);
+        power = allocWords(srvInterface, upLen > downLen ? upLen : downLen);
+        num = allocWords(srvInterface, numLen);
+        den = allocWords(srvInterface, denLen);
+        quotient = allocWords(srvInterface, numLen);
+        root = allocWords(srvInterface, rootLen > 0 ? rootLen : 1);
+        work = allocWords(srvInterface, workLen > 5 * rootLen + 1
+                                        ? workLen : 5 * rootLen + 1);
+        scratch = allocWords(srvInterface,
+                             2 * (sumsLen > squaresLen ? sumsLen : squaresLen));
+    }
+
+    // every SUM = 0, cnt = 0
+    virtual void initAggregate(ServerInterface &srvInterface,
+                               IntermediateAggs &aggs)
+    {
+        try {
+            for (int32 i = 0; i < sums; ++i) {
+                sumColumn[i].clear(aggs);
+            }
+            aggs.getIntRef(sums) = 0;
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in initAggregate: [%s]",
+                            pairName(kind), e.what());
+        }
+    }
+
+    // Every SUM and cnt += each pair where neither value is NULL.
+    virtual void aggregate(ServerInterface &srvInterface,
+                           BlockReader &argReader,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            uint64 *sum[MAX_PAIR_SUMS];
+            for (int32 i = 0; i < sums; ++i) {
+                sum[i] = sumColumn[i].load(aggs);
+            }
+            vint &cnt = aggs.getIntRef(sums);
+            cnt += useInt128Lane ? aggregateInt128(argReader, sum)
+                                 : aggregateWords(argReader, sum);
+            checkRowCount(cnt);
+            for (int32 i = 0; i < sums; ++i) {
+                sumColumn[i].store(aggs);
+            }
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in aggregate: [%s]",
+                            pairName(kind), e.what());
+        }
+    }
+
+    // The SUMs are exact integers of a fixed width, so partials just add.
+    virtual void combine(ServerInterface &srvInterface,
+                         IntermediateAggs &aggs,
+                         MultipleIntermediateAggs &aggsOther)
+    {
+        try {
+            uint64 *sum[MAX_PAIR_SUMS];
+            for (int32 i = 0; i < sums; ++i) {
+                sum[i] = sumColumn[i].load(aggs);
+            }
+            vint &cnt = aggs.getIntRef(sums);
+            do {
+                for (int32 i = 0; i < sums; ++i) {
+                    addWords(sum[i], sumColumn[i].loadOther(aggsOther),
+                             sumLen[i]);
+                }
+                cnt += aggsOther.getIntRef(sums);
+            } while (aggsOther.next());
+            checkRowCount(cnt);
+            for (int32 i = 0; i < sums; ++i) {
+                sumColumn[i].store(aggs);
+            }
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in combine: [%s]",
+                            pairName(kind), e.what());
+        }
+    }
+
+    virtual void terminate(ServerInterface &srvInterface,
+                           BlockWriter &resWriter,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            const vint rowCount = aggs.getIntRef(sums);
+            if (rowCount < 0) {
+                vt_report_error(0,
+                    "%s: internal error: negative row count %lld",
+                    pairName(kind), static_cast<long long>(rowCount));
+            }
+            VNumeric &out = resWriter.getNumericRef(0);
+            if (rowCount == 0) {
+                out.setNull();
+                return;
+            }
+            const uint64 n = static_cast<uint64>(rowCount);
+
+            const uint64 *sum[MAX_PAIR_SUMS];
+            for (int32 i = 0; i < sums; ++i) {
+                sum[i] = sumColumn[i].load(aggs);
+            }
+            crossMoment(c, cLen, n, sum[SUM_XY], sumLen[SUM_XY],
+                        sum[SUM_X], sumLen[SUM_X], sum[SUM_Y], sumLen[SUM_Y],
+                        scratch);
+            const bool neg = static_cast<int64>(c[0]) < 0;
+            if (neg) {
+                negateWords(c, cLen);
+            }
+            if (kind != COVAR_POP) {
+                crossMoment(a, aLen, n, sum[SUM_XX], sumLen[SUM_XX],
+                            sum[SUM_X], sumLen[SUM_X], sum[SUM_X], sumLen[SUM_X],
+                            scratch);
+                if (kind == CORR) {
+                    crossMoment(b, bLen, n, sum[SUM_YY], sumLen[SUM_YY],
+                                sum[SUM_Y], sumLen[SUM_Y], sum[SUM_Y],
+                                sumLen[SUM_Y], scratch);
+                }
+                if (isZeroWords(a, aLen) || (kind == CORR && isZeroWords(b, bLen))) {
+                    out.setNull();
+                    return;
+                }
+            }
+
+            // num = M 10^scaleUp
+            const uint64 *m = c;
+            if (kind == CORR) {
+                cSquared[0] = 0;
+                multiplyMagnitudes(c, cLen, c, cLen, cSquared + 1);
+                multiplyWords(cSquared, mLen, 4);
+                m = cSquared;
+            }
+            powerOfTen(power, upLen, scaleUp);
+            memset(num, 0, static_cast<size_t>(numLen - mLen - upLen) * sizeof(uint64));
+            multiplyMagnitudes(m, mLen, power, upLen, num + (numLen - mLen - upLen));
+
+            // den = D 10^scaleDown
+            const uint64 *d = base;
+            if (kind == COVAR_POP) {
+                const unsigned __int128 nn = static_cast<unsigned __int128>(n) * n;
+                base[0] = static_cast<uint64>(nn >> 64);
+                base[1] = static_cast<uint64>(nn);
+            } else if (kind == REGR_SLOPE) {
+                d = a;
+            } else {
+                multiplyMagnitudes(a, aLen, b, bLen, base);
+            }
+            powerOfTen(power, downLen, scaleDown);
+            multiplyMagnitudes(d, baseLen, power, downLen, den);
+
+            const uint64 *result = quotient;
+            int32 resultLen = numLen;
+            if (kind == CORR) {
+                // round(sqrt(x)) = (floor(sqrt(floor(4 x))) + 1) / 2
+                divideMagnitudes(num, numLen, den, denLen, quotient, work);
+                squareRoot(quotient + (numLen - rootLen), rootLen, root, work);
+                const uint64 one = 1;
+                addMagnitude(root, rootLen, &one, 1);
+                divideWords(root, rootLen, 2);
+                result = root;
+                resultLen = rootLen;
+            } else {
+                roundedQuotient(num, numLen, den, denLen, quotient, work);
+            }
+
+            if (!storeMagnitude(result, resultLen, neg, limit, out)) {
+                vt_report_error(0,
+                    "%s: the result does not fit in the result type "
+                    "NUMERIC(%d, %d)",
+                    pairName(kind), out.getPrecision(), out.getScale());
+            }
+        } catch (std::exception &e) {
+            vt_report_error(0, "%s: error in terminate: [%s]",
+                            pairName(kind), e.what());
+        }
+    }
+
+private:
+    // Which of the three aggregates this is.
+    PairKind kind;
+
+    // How many SUMs it keeps (see PairSum), the words in each, and access
+    // to each, which lives in a VARBINARY (more than 1024 digits) rather
+    // than a NUMERIC when it is wide.
+    int32 sums;
+    int32 sumLen[MAX_PAIR_SUMS];
+    SumColumn sumColumn[MAX_PAIR_SUMS];
+
+    // Words in y and x, and in the lanes: the wider of the two.
+    int32 yWords;
+    int32 xWords;
+    int32 laneWords;
+
+    // True for y and x both NUMERIC(p <= 18), with SUM(y) and SUM(x) of at
+    // least two words: one int64 word per value, in native 128-bit
+    // arithmetic.
+    bool useInt128Lane;
+
+    // CrossMomentBlock<laneWords> and its lanes, which flushLowLanes()
+    // leaves cleared for the next block, upper lanes included.
+    CrossMomentBlock<1>::Fn blockKernel;
+    PairLanes lanes;
+
+    // The max_rows parameter; the SUMs only have room for this many rows.
+    vint maxRows;
+
+    // Powers of ten between the quotient's scale and the result's; at most
+    // one of them is non-zero.
+    int32 scaleUp;
+    int32 scaleDown;
+
+    // Words in terminate()'s values: Cxy, Cxx, Cyy, M, D, the powers of
+    // ten, num (and the quotient), den and the square root's argument.
+    int32 cLen;
+    int32 aLen;
+    int32 bLen;
+    int32 mLen;
+    int32 baseLen;
+    int32 upLen;
+    int32 downLen;
+    int32 numLen;
+    int32 denLen;
+    int32 rootLen;
+
+    // 10^p_out, which the result's magnitude must stay below.
+    uint64 *limit;
+
+    // terminate()'s scratch, allocated in setup(): |Cxy|, Cxx, Cyy,
+    // 4 Cxy^2, D, a power of ten, num, den, the quotient, its square root,
+    // the division workspace and crossMoment()'s.
+    uint64 *c;
+    uint64 *a;
+    uint64 *b;
+    uint64 *cSquared;
+    uint64 *base;
+    uint64 *power;
+    uint64 *num;
+    uint64 *den;
+    uint64 *quotient;
+    uint64 *root;
+    uint64 *work;
+    uint64 *scratch;
+
+    static uint64 *allocWords(ServerInterface &srvInterface, int32 n)
+    {
+        return static_cast<uint64 *>(srvInterface.allocator->alloc(
+            static_cast<size_t>(n) * sizeof(uint64)));
+    }
+
+    // Words for n * SUM(a b) - SUM(a) SUM(b); see crossMoment().
+    int32 crossLength(int32 ab, int32 a, int32 b) const
+    {
+        const int32 product = sumLen[a] + sumLen[b];
+        return (sumLen[ab] + 1 > product ? sumLen[ab] + 1 : product) + 1;
+    }
+
+    void checkRowCount(vint cnt) const
+    {
+        if (cnt > maxRows) {
+            vt_report_error(0,
+                "%s: a group has more than max_rows = %lld non-NULL pairs; "
+                "raise max_rows or omit it",
+                pairName(kind), static_cast<long long>(maxRows));
+        }
+    }
+
+    /*
+     * y and x NUMERIC(p <= 18): each value is one int64 word, and each
+     * product or square is below 10^36 < 2^120. SUM(y) and SUM(x) are kept
+     * for the block in __int128s (as in ExactAvg::aggregateInt128()), the
+     * squares' SUMs in unsigned __int128s plus a word counting their
+     * carries, and SUM(x * y) in an unsigned __int128 of two's complement
+     * products plus a word counting its carries less its negative
+     * products. All are added to the group's SUMs once per block.
+     */
+    vint aggregateInt128(BlockReader &argReader, uint64 *const *sum) const
+    {
+        const bool squareX = sums > SUM_XX;
+        const bool squareY = sums > SUM_YY;
+        __int128 totalY = 0;
+        __int128 totalX = 0;
+        unsigned __int128 products = 0;
+        int64 productsHigh = 0;
+        unsigned __int128 xSquares = 0;
+        uint64 xSquaresHigh = 0;
+        unsigned __int128 ySquares = 0;
+        uint64 ySquaresHigh = 0;
+        vint rows = 0;
+
+        do {
+            const int64 y =
+                static_cast<int64>(argReader.getNumericRef(0).words[0]);
+            const int64 x =
+                static_cast<int64>(argReader.getNumericRef(1).words[0]);
+            if (y == vint_null || x == vint_null) {
+                continue;
+            }
+            totalY += y;
+            totalX += x;
+            const unsigned __int128 xy = static_cast<unsigned __int128>(
+                static_cast<__int128>(x) * y);
+            products += xy;
+            productsHigh += static_cast<int64>(products < xy) -
+                            static_cast<int64>(xy >> 127);
+            if (squareX) {
+                const uint64 mag = x < 0 ? 0 - static_cast<uint64>(x)
+                                         : static_cast<uint64>(x);
+                const unsigned __int128 sq =
+                    static_cast<unsigned __int128>(mag) * mag;
+                xSquares += sq;
+                xSquaresHigh += xSquares < sq;
+            }
+            if (squareY) {
+                const uint64 mag = y < 0 ? 0 - static_cast<uint64>(y)
+                                         : static_cast<uint64>(y);
+                const unsigned __int128 sq =
+                    static_cast<unsigned __int128>(mag) * mag;
+                ySquares += sq;
+                ySquaresHigh += ySquares < sq;
+            }
+            rows++;
+        } while (argReader.next());
+
+        accumulateInt128(sum[SUM_Y], sumLen[SUM_Y], totalY);
+        accumulateInt128(sum[SUM_X], sumLen[SUM_X], totalX);
+        const uint64 xyWords[3] = { static_cast<uint64>(productsHigh),
+                                    static_cast<uint64>(products >> 64),
+                                    static_cast<uint64>(products) };
+        addSignedWords(sum[SUM_XY], sumLen[SUM_XY], xyWords, 3);
+        if (squareX) {
+            const uint64 words[3] = { xSquaresHigh,
+                                      static_cast<uint64>(xSquares >> 64),
+                                      static_cast<uint64>(xSquares) };
+            addSignedWords(sum[SUM_XX], sumLen[SUM_XX], words, 3);
+        }
+        if (squareY) {
+            const uint64 words[3] = { ySquaresHigh,
+                                      static_cast<uint64>(ySquares >> 64),
+                                      static_cast<uint64>(ySquares) };
+            addSignedWords(sum[SUM_YY], sumLen[SUM_YY], words, 3);
+        }
+        return rows;
+    }
+
+    // Wider inputs: CrossMomentBlock, flushed into the SUMs once per block.
+    vint aggregateWords(BlockReader &argReader, uint64 *const *sum)
+    {
+        const vint rows = blockKernel(argReader, yWords, xWords, lanes);
+
+        flushLowLanes(sum[SUM_Y], sumLen[SUM_Y], lanes.y, laneWords,
+                      lanes.yNegatives);
+        flushLowLanes(sum[SUM_X], sumLen[SUM_X], lanes.x, laneWords,
+                      lanes.xNegatives);
+        lanes.yNegatives = 0;
+        lanes.xNegatives = 0;
+        flushLowLanes(sum[SUM_XY], sumLen[SUM_XY], lanes.xyPositive,
+                      2 * laneWords, 0);
+        flushLowLanes(sum[SUM_XY], sumLen[SUM_XY], lanes.xyNegative,
+                      2 * laneWords, 0, true);
+        if (lanes.xx) {
+            flushLowLanes(sum[SUM_XX], sumLen[SUM_XX], lanes.xx, 2 * laneWords,
+                          0);
+        }
+        if (lanes.yy) {
+            flushLowLanes(sum[SUM_YY], sumLen[SUM_YY], lanes.yy, 2 * laneWords,
+                          0);
+        }
+        return rows;
+    }
+};
+
 /**
- * exact_avg(NUMERIC(p,s)) -> NUMERIC(p_out, s_out)
+ * Factory for exact_covar_pop; exact_corr and exact_regr_slope differ only
+ * in the PairKind they pass. Two NUMERIC arguments, (y, x), with the
+ * intermediate SUMs sized like ExactAvgFactory's SUM.
+ */
+class ExactCovarianceFactory : public AggregateFunctionFactory
+{
+public:
+    explicit ExactCovarianceFactory(PairKind kind = COVAR_POP) : kind(kind) {}
+
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addNumeric();
+        argTypes.addNumeric();
+        returnType.addNumeric();
+    }
+
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
+    {
+        checkArguments(inputTypes);
+        addPairType(inputTypes, kind,
+                    maxRowsParameter(srvInterface, pairName(kind)),
+                    outputTypes);
+    }
+
+    // sumy:  NUMERIC(p_y + 19, s_y)
+    // sumx:  NUMERIC(p_x + 19, s_x)
+    // sumxy: NUMERIC(p_x + p_y + 19, s_x + s_y)
+    // sumxx: NUMERIC(2 p_x + 19, 2 s_x)     exact_corr, exact_regr_slope
+    // sumyy: NUMERIC(2 p_y + 19, 2 s_y)     exact_corr
+    // cnt:   INTEGER
+    // with fewer digits under max_rows, and a VARBINARY past 1024 digits.
+    virtual void getIntermediateTypes(ServerInterface &srvInterface,
+                                      const SizedColumnTypes &inputTypes,
+                                      SizedColumnTypes &intermediateTypes)
+    {
+        checkArguments(inputTypes);
+
+        int32 p_sum[MAX_PAIR_SUMS];
+        int32 s_sum[MAX_PAIR_SUMS];
+        const int32 sums = pairSumTypes(
+            inputTypes, kind, maxRowsParameter(srvInterface, pairName(kind)),
+            p_sum, s_sum);
+        for (int32 i = 0; i < sums; ++i) {
+            addSumType(p_sum[i], s_sum[i], PAIR_SUM_NAMES[i],
+                       intermediateTypes);
+        }
+        intermediateTypes.addInt("cnt");
+    }
+
+    // Optional: max_rows, as for exact_avg.
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes)
+    {
+        parameterTypes.addInt("max_rows");
+    }
+
+    virtual AggregateFunction *createAggregateFunction(
+        ServerInterface &srvInterface)
+    {
+        return vt_createFuncObject<ExactCovariance>(srvInterface.allocator, kind);
+    }
+
+private:
+    PairKind kind;
+
+    void checkArguments(const SizedColumnTypes &inputTypes) const
+    {
+        if (inputTypes.getColumnCount() != 2 ||
+            !inputTypes.getColumnType(0).isNumeric() ||
+            !inputTypes.getColumnType(1).isNumeric()) {
+            vt_report_error(0,
+                "%s expects exactly two NUMERIC arguments", pairName(kind));
+        }
+    }
+};
+
+class ExactCovarPopFactory : public ExactCovarianceFactory
+{
+public:
+    ExactCovarPopFactory() : ExactCovarianceFactory(COVAR_POP) {}
+};
+
+class ExactCorrFactory : public ExactCovarianceFactory
+{
+public:
+    ExactCorrFactory() : ExactCovarianceFactory(CORR) {}
+};
+
+class ExactRegrSlopeFactory : public ExactCovarianceFactory
+{
+public:
+    ExactRegrSlopeFactory() : ExactCovarianceFactory(REGR_SLOPE) {}
+};
+
+RegisterFactory(ExactCovarPopFactory);
+RegisterFactory(ExactCorrFactory);
+RegisterFactory(ExactRegrSlopeFactory);
+
+/*
+ * Exact weighted average (ExactWavgFactory):
  *
- * Goals:
- *  - Be as fast as possible by using a dynamically-sized intermediate SUM type,
- *    not always NUMERIC(1024, ...).
- *  - Be 100% accurate whenever the exact SUM can fit in Vertica's NUMERIC(1024, ...).
- *  - If the exact SUM cannot be represented within NUMERIC(1024, ...), detect this
- *    and raise a clear error instead of returning a wrong answer.
+ *   exact_wavg(v, w) = SUM(v * w) / SUM(w)
  *
- * Theory:
- *  - Input type: NUMERIC(p_in, s_in).
- *  - Worst-case magnitude of each value: < 10^(p_in - s_in).
- *  - Sum of N such values can need up to:
- *        p_needed = p_in + ceil(log10(N))
- *    decimal digits of precision in total (integer + fractional).
- *  - Vertica caps p at 1024, so if p_needed > 1024, no exact sum is possible
- *    for any implementation (built-in or UDX).
+ * over the rows where neither v nor w is NULL. It replaces
+ * SUM(price * qty) / SUM(qty), which takes two NUMERIC aggregates and can
+ * overflow the product's SUM. The state is ExactAvg's (sum, cnt) with the
+ * weights' SUM added. sum is SUM(v * w), an exact integer sized like
+ * exact_avg's SUM for a p_v + p_w digit input, and wsum is SUM(w). Both
+ * come from one pass over CrossMomentBlock's lanes, merge exactly in
+ * combine(), and are divided once, rounding half up, in terminate().
  *
- * Implementation:
- *  - Intermediate SUM type: NUMERIC(p_sum, s_sum) with
- *        p_sum = min(1024, p_in + 19),
- *        s_sum = clamp(s_in, 0, p_sum).
- *    19 extra digits covers any possible 64-bit row count (N <= 9e18, 19 digits).
- *  - We store p_in and s_in in the intermediate state alongside sum and cnt.
- *  - In terminate():
- *        p_needed = p_in + digits10(rowCount)
- *    If p_needed > 1024, we raise a clear error that explains the problem.
- *    Otherwise, p_sum >= p_needed by construction, so the sum is exactly
- *    representable and the UDX returns the exact average.
+ * The result has exact_avg(v)'s type. With weights of one sign it is
+ * bounded by the largest |v| and always fits. Weights of mixed sign can
+ * put it anywhere, and a result that does not fit is an error, like
+ * exact_avg's. No rows, or weights that sum to zero, give NULL.
+ */
+class ExactWavg : public AggregateFunction
+{
+public:
+    ExactWavg()
+        : valueWords(0), weightWords(0), laneWords(0), sumLen(0), weightLen(0),
+          wideSum(false), wideWeight(false), useInt128Lane(false),
+          blockKernel(0), maxRows(MAX_ROW_COUNT), scaleUp(0), numLen(0),
+          limit(0), num(0), den(0), quotient(0), work(0)
+    {
+        memset(&lanes, 0, sizeof(lanes));
+    }
+
+    InlineAggregate()
+
+    // Size both SUMs and the result from the input types, and allocate the
+    // lanes and terminate()'s scratch once per function instance.
+    virtual void setup(ServerInterface &srvInterface,
+                       const SizedColumnTypes &argTypes)
+    {
+        const VerticaType &valueType = argTypes.getColumnType(0);
+        const VerticaType &weightType = argTypes.getColumnType(1);
+        int32 p_v;
+        int32 s_v;
+        int32 p_w;
+        int32 s_w;
+        inputPrecisionScale(valueType, "exact_wavg", p_v, s_v);
+        inputPrecisionScale(weightType, "exact_wavg", p_w, s_w);
+        valueWords = valueType.getNumericWordCount();
+        weightWords = weightType.getNumericWordCount();
+        laneWords = valueWords > weightWords ? valueWords : weightWords;
+        maxRows = maxRowsParameter(srvInterface, "exact_wavg");
+
+        const int32 rowDigits = rowCountDigitsFor(maxRows);
+        const int32 p_sum = sumPrecisionFor(p_v + p_w, rowDigits);
+        const int32 p_wsum = sumPrecisionFor(p_w, rowDigits);
+        wideSum = p_sum > MAX_NUMERIC_PRECISION;
+        wideWeight = p_wsum > MAX_NUMERIC_PRECISION;
+        sumLen = sumWordsFor(p_sum);
+        weightLen = sumWordsFor(p_wsum);
+        sumColumn.setup(srvInterface, 0, sumLen, wideSum);
+        weightColumn.setup(srvInterface, 1, weightLen, wideWeight);
+        useInt128Lane = p_v <= MAX_INT128_LANE_PRECISION &&
+                        p_w <= MAX_INT128_LANE_PRECISION && weightLen >= 2;
+        blockKernel =
+            KernelPicker<CrossMomentBlock, MAX_NUMERIC_WORDS>::pick(laneWords);
+
+        // The value is CrossMomentBlock's y and the weight its x; only
+        // SUM(x) and SUM(x y) are kept.
+        const size_t laneBytes =
+            static_cast<size_t>(5 * laneWords) * sizeof(unsigned __int128);
+        unsigned __int128 *laneBase = static_cast<unsigned __int128 *>(
+            srvInterface.allocator->alloc(laneBytes));
+        memset(laneBase, 0, laneBytes);
+        lanes.x = laneBase;
+        lanes.xyPositive = laneBase + laneWords;
+        lanes.xyNegative = laneBase + 3 * laneWords;
+
+        // sum / wsum is at scale s_v; the result's scale is at most five
+        // digits more (see addAverageType()).
+        SizedColumnTypes outTypes;
+        addAverageType(valueType, "exact_wavg", outTypes);
+        const VerticaType &outType = outTypes.getColumnType(0);
+        scaleUp = outType.getNumericScale() - s_v;
+
+        const int32 outWords = outType.getNumericWordCount();
+        limit = allocWords(srvInterface, outWords);
+        powerOfTen(limit, outWords, outType.getNumericPrecision());
+
+        numLen = sumLen + 1 > outWords ? sumLen + 1 : outWords;
+        num = allocWords(srvInterface, numLen);
+        den = allocWords(srvInterface, weightLen);
+        quotient = allocWords(srvInterface, numLen);
+        work = allocWords(srvInterface, numLen + weightLen + 1);
+    }
+
+    // sum = wsum = 0, cnt = 0
+    virtual void initAggregate(ServerInterface &srvInterface,
+                               IntermediateAggs &aggs)
+    {
+        try {
+            sumColumn.clear(aggs);
+            weightColumn.clear(aggs);
+            aggs.getIntRef(2) = 0;
+        } catch (std::exception &e) {
+            vt_report_error(0, "exact_wavg: error in initAggregate: [%s]",
+                            e.what());
+        }
+    }
+
+    // sum += v * w, wsum += w and cnt += 1 for every row where neither v
+    // nor w is NULL.
+    virtual void aggregate(ServerInterface &srvInterface,
+                           BlockReader &argReader,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            uint64 *sum = sumColumn.load(aggs);
+            uint64 *weights = weightColumn.load(aggs);
+            vint &cnt = aggs.getIntRef(2);
+            cnt += useInt128Lane
+                ? aggregateInt128(argReader, sum, weights)
+                : aggregateWords(argReader, sum, weights);
+            checkRowCount(cnt);
+            sumColumn.store(aggs);
+            weightColumn.store(aggs);
+        } catch (std::exception &e) {
+            vt_report_error(0, "exact_wavg: error in aggregate: [%s]",
+                            e.what());
+        }
+    }
+
+    // Both SUMs are exact integers of a fixed width, so partials just add.
+    virtual void combine(ServerInterface &srvInterface,
+                         IntermediateAggs &aggs,
+                         MultipleIntermediateAggs &aggsOther)
+    {
+        try {
+            uint64 *sum = sumColumn.load(aggs);
+            uint64 *weights = weightColumn.load(aggs);
+            vint &cnt = aggs.getIntRef(2);
+            do {
+                addWords(sum, sumColumn.loadOther(aggsOther), sumLen);
+                addWords(weights, weightColumn.loadOther(aggsOther), weightLen);
+                cnt += aggsOther.getIntRef(2);
+            } while (aggsOther.next());
+            checkRowCount(cnt);
+            sumColumn.store(aggs);
+            weightColumn.store(aggs);
+        } catch (std::exception &e) {
+            vt_report_error(0, "exact_wavg: error in combine: [%s]",
+                            e.what());
+        }
+    }
+
+    virtual void terminate(ServerInterface &srvInterface,
+                           BlockWriter &resWriter,
+                           IntermediateAggs &aggs)
+    {
+        try {
+            const vint rowCount = aggs.getIntRef(2);
+            if (rowCount < 0) {
+                vt_report_error(0,
+                    "exact_wavg: internal error: negative row count %lld",
+                    static_cast<long long>(rowCount));
+            }
+            VNumeric &out = resWriter.getNumericRef(0);
+            const uint64 *weights = weightColumn.load(aggs);
+            if (rowCount == 0 || isZeroWords(weights, weightLen)) {
+                out.setNull();
+                return;
+            }
+
+            // |sum| 10^scaleUp / |wsum|, with the sign of sum / wsum.
+            const uint64 *sum = sumColumn.load(aggs);
+            const bool negSum = static_cast<int64>(sum[0]) < 0;
+            const bool negWeights = static_cast<int64>(weights[0]) < 0;
+            memset(num, 0, static_cast<size_t>(numLen - sumLen) * sizeof(uint64));
+            memcpy(num + (numLen - sumLen), sum,
+                   static_cast<size_t>(sumLen) * sizeof(uint64));
+            if (negSum) {
+                negateWords(num + (numLen - sumLen), sumLen);
+            }
+            multiplyWords(num, numLen, POW10[scaleUp]);
+            memcpy(den, weights, static_cast<size_t>(weightLen) * sizeof(uint64));
+            if (negWeights) {
+                negateWords(den, weightLen);
+            }
+            roundedQuotient(num, numLen, den, weightLen, quotient, work);
+
+            if (!storeMagnitude(quotient, numLen, negSum != negWeights, limit,
+                                out)) {
+                vt_report_error(0,
+                    "exact_wavg: the result does not fit in the result type "
+                    "NUMERIC(%d, %d); the weights have mixed signs",
+                    out.getPrecision(), out.getScale());
+            }
+        } catch (std::exception &e) {
+            vt_report_error(0, "exact_wavg: error in terminate: [%s]",
+                            e.what());
+        }
+    }
+
+private:
+    // Words in v and w, and in the lanes: the wider of the two.
+    int32 valueWords;
+    int32 weightWords;
+    int32 laneWords;
+
+    // Words in SUM(v * w) and SUM(w), whether each lives in a VARBINARY
+    // (more than 1024 digits) rather than a NUMERIC, and access to each.
+    int32 sumLen;
+    int32 weightLen;
+    bool wideSum;
+    bool wideWeight;
+    SumColumn sumColumn;
+    SumColumn weightColumn;
+
+    // True for v and w both NUMERIC(p <= 18), with a SUM(w) of at least
+    // two words: one int64 word per value, in native 128-bit arithmetic.
+    bool useInt128Lane;
+
+    // CrossMomentBlock<laneWords> and its lanes (SUM(x) and SUM(x y) only),
+    // which flushLowLanes() leaves cleared for the next block, upper lanes
+    // included.
+    CrossMomentBlock<1>::Fn blockKernel;
+    PairLanes lanes;
+
+    // The max_rows parameter; both SUMs only have room for this many rows.
+    vint maxRows;
+
+    // Powers of ten from sum / wsum's scale s_v up to the result's.
+    int32 scaleUp;
+
+    // Words in terminate()'s numerator and quotient.
+    int32 numLen;
+
+    // 10^p_out, which the result's magnitude must stay below.
+    uint64 *limit;
+
+    // terminate()'s scratch, allocated in setup(): the numerator, |wsum|,
+    // the quotient and the division workspace.
+    uint64 *num;
+    uint64 *den;
+    uint64 *quotient;
+    uint64 *work;
+
+    static uint64 *allocWords(ServerInterface &srvInterface, int32 n)
+    {
+        return static_cast<uint64 *>(srvInterface.allocator->alloc(
+            static_cast<size_t>(n) * sizeof(uint64)));
+    }
+
+    void checkRowCount(vint cnt) const
+    {
+        if (cnt > maxRows) {
+            vt_report_error(0,
+                "exact_wavg: a group has more than max_rows = %lld non-NULL "
+                "rows; raise max_rows or omit it",
+                static_cast<long long>(maxRows));
+        }
+    }
+
+    /*
+     * v and w NUMERIC(p <= 18): each value is one int64 word and each
+     * product is below 10^36 < 2^120. The block's SUM(w) is kept in an
+     * __int128 and its SUM(v * w) as in ExactCovariance::aggregateInt128(),
+     * and both are added to the group's SUMs once per block.
+     */
+    vint aggregateInt128(BlockReader &argReader, uint64 *sum,
+                         uint64 *weights) const
+    {
+        __int128 totalWeight = 0;
+        unsigned __int128 products = 0;
+        int64 productsHigh = 0;
+        vint rows = 0;
+
+        do {
+            const int64 v =
+                static_cast<int64>(argReader.getNumericRef(0).words[0]);
+            const int64 w =
+                static_cast<int64>(argReader.getNumericRef(1).words[0]);
+            if (v == vint_null || w == vint_null) {
+                continue;
+            }
+            totalWeight += w;
+            const unsigned __int128 vw = static_cast<unsigned __int128>(
+                static_cast<__int128>(v) * w);
+            products += vw;
+            productsHigh += static_cast<int64>(products < vw) -
+                            static_cast<int64>(vw >> 127);
+            rows++;
+        } while (argReader.next());
+
+        accumulateInt128(weights, weightLen, totalWeight);
+        const uint64 words[3] = { static_cast<uint64>(productsHigh),
+                                  static_cast<uint64>(products >> 64),
+                                  static_cast<uint64>(products) };
+        addSignedWords(sum, sumLen, words, 3);
+        return rows;
+    }
+
+    // Wider inputs: CrossMomentBlock, flushed into the SUMs once per block.
+    vint aggregateWords(BlockReader &argReader, uint64 *sum, uint64 *weights)
+    {
+        const vint rows =
+            blockKernel(argReader, valueWords, weightWords, lanes);
+
+        flushLowLanes(weights, weightLen, lanes.x, laneWords, lanes.xNegatives);
+        lanes.xNegatives = 0;
+        flushLowLanes(sum, sumLen, lanes.xyPositive, 2 * laneWords, 0);
+        flushLowLanes(sum, sumLen, lanes.xyNegative, 2 * laneWords, 0, true);
+        return rows;
+    }
+};
+
+/**
+ * Factory for exact_wavg: (value, weight), both NUMERIC, with exact_avg's
+ * result type for the value and its (sum, cnt) state plus SUM(weight).
  */
-class ExactAvg : public AggregateFunction
+class ExactWavgFactory : public AggregateFunctionFactory
 {
 public:
-    // Let Vertica generate the vectorized aggregateArrs() wrapper.
-    // It will call our aggregate() below for each chunk.
-    InlineAggregate();
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addNumeric();
+        argTypes.addNumeric();
+        returnType.addNumeric();
+    }
 
-    // Initialize intermediate state: sum = 0, cnt = 0, p_in = 0, s_in = 0
-    virtual void initAggregate(ServerInterface &srvInterface,
-                               IntermediateAggs &aggs)
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
     {
-        try {
-            VNumeric &sum = aggs.getNumericRef(0);
-            sum.setZero();
+        checkArguments(inputTypes);
+        addAverageType(inputTypes.getColumnType(0), "exact_wavg", outputTypes);
+    }
 
-            vint &cnt = aggs.getIntRef(1);
-            cnt = 0;
+    // sum:  NUMERIC(p_v + p_w + 19, s_v + s_w), SUM(v * w)
+    // wsum: NUMERIC(p_w + 19, s_w), SUM(w)
+    // cnt:  INTEGER
+    // with fewer digits under max_rows, and a VARBINARY past 1024 digits.
+    virtual void getIntermediateTypes(ServerInterface &srvInterface,
+                                      const SizedColumnTypes &inputTypes,
+                                      SizedColumnTypes &intermediateTypes)
+    {
+        checkArguments(inputTypes);
 
-            // p_in and s_in will be set in the first call to aggregate()
-            // based on the input column type.
-            vint &p_in_stored = aggs.getIntRef(2);
-            p_in_stored = 0;
+        int32 p_v;
+        int32 s_v;
+        int32 p_w;
+        int32 s_w;
+        inputPrecisionScale(inputTypes.getColumnType(0), "exact_wavg", p_v, s_v);
+        inputPrecisionScale(inputTypes.getColumnType(1), "exact_wavg", p_w, s_w);
+        const int32 rowDigits =
+            rowCountDigitsFor(maxRowsParameter(srvInterface, "exact_wavg"));
 
-            vint &s_in_stored = aggs.getIntRef(3);
-            s_in_stored = 0;
-        } catch (std::exception &e) {
+        addSumType(sumPrecisionFor(p_v + p_w, rowDigits), s_v + s_w, "sum",
+                   intermediateTypes);                          // index 0
+        addSumType(sumPrecisionFor(p_w, rowDigits), s_w, "wsum",
+                   intermediateTypes);                          // index 1
+        intermediateTypes.addInt("cnt");                        // index 2
+    }
+
+    // Optional: max_rows, as for exact_avg.
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes)
+    {
+        parameterTypes.addInt("max_rows");
+    }
+
+    virtual AggregateFunction *createAggregateFunction(
+        ServerInterface &srvInterface)
+    {
+        return vt_createFuncObject<ExactWavg>(srvInterface.allocator);
+    }
+
+private:
+    static void checkArguments(const SizedColumnTypes &inputTypes)
+    {
+        if (inputTypes.getColumnCount() != 2 ||
+            !inputTypes.getColumnType(0).isNumeric() ||
+            !inputTypes.getColumnType(1).isNumeric()) {
             vt_report_error(0,
-                "exact_avg: error in initAggregate: [%s]", e.what());
+                "exact_wavg expects exactly two NUMERIC arguments");
         }
     }
+};
 
-    // Aggregate input rows into (sum, cnt)
-    virtual void aggregate(ServerInterface &srvInterface,
-                           BlockReader &argReader,
-                           IntermediateAggs &aggs)
-    {
-        try {
-            VNumeric &sum = aggs.getNumericRef(0);
-            vint &cnt = aggs.getIntRef(1);
-            vint &p_in_stored = aggs.getIntRef(2);
-            vint &s_in_stored = aggs.getIntRef(3);
+RegisterFactory(ExactWavgFactory);
 
-            // On the first call, record the input NUMERIC(p_in, s_in) in the
-            // intermediate state so we can use it later to diagnose overflow.
-            if (p_in_stored == 0) {
-                const VerticaType &inType =
-                    argReader.getTypeMetaData().getColumnType(0);
+/*
+ * Analytic exact_avg over a sliding window (ExactMovingAvgFactory):
+ *
+ *   exact_moving_avg(a USING PARAMETERS window_rows = 1000)
+ *       OVER (PARTITION BY ... ORDER BY t)
+ *
+ * is AVG(a) OVER (... ROWS BETWEEN 999 PRECEDING AND CURRENT ROW), exact.
+ * Vertica does not pass a window frame to analytic UDxs, so the frame
+ * length is the window_rows parameter.
+ *
+ * Integer sums are exactly invertible, so the window's SUM is kept up to
+ * date in O(1) per row rather than re-summed: the entering value is added
+ * and the value leaving the frame is added back negated. The last
+ * window_rows values are kept, already negated, in a ring buffer, which
+ * grows with the partition so that a window much longer than the
+ * partitions costs no more memory than they do.
+ */
 
-                if (!inType.isNumeric()) {
-                    vt_report_error(0,
-                        "exact_avg expects a NUMERIC/DECIMAL input type");
-                }
+// Initial ring buffer length, in rows.
+static const vint MIN_WINDOW_SLOTS = 1024;
 
-                int32 p_in = inType.getNumericPrecision();
-                int32 s_in = inType.getNumericScale();
+// Reads the required window_rows parameter: the frame length in rows.
+static vint windowRowsParameter(ServerInterface &srvInterface)
+{
+    ParamReader params = srvInterface.getParamReader();
+    if (!params.containsParameter("window_rows")) {
+        vt_report_error(0,
+            "exact_moving_avg: the window_rows parameter is required");
+    }
+    const vint windowRows = params.getIntRef("window_rows");
+    if (windowRows == vint_null || windowRows < 1) {
+        vt_report_error(0,
+            "exact_moving_avg: window_rows must be a positive integer");
+    }
+    return windowRows;
+}
 
-                if (p_in <= 0 || p_in > MAX_NUMERIC_PRECISION) {
-                    vt_report_error(0,
-                        "exact_avg: invalid input NUMERIC precision %d", p_in);
-                }
+class ExactMovingAvg : public AnalyticFunction
+{
+public:
+    ExactMovingAvg()
+        : sumScale(0), sumLen(0), inWords(0), windowRows(0), windowSlots(0),
+          addKernel(0), sum(0), window(0), windowNonNull(0), divWords(0)
+    {
+    }
 
-                p_in_stored = p_in;
-                s_in_stored = s_in;
-            }
+    // Size the SUM for window_rows values and allocate it, the ring buffer
+    // and the division scratch once per function instance.
+    virtual void setup(ServerInterface &srvInterface,
+                       const SizedColumnTypes &argTypes)
+    {
+        const VerticaType &inType = argTypes.getColumnType(0);
+        int32 p_in;
+        inputPrecisionScale(inType, "exact_moving_avg", p_in, sumScale);
+        inWords = inType.getNumericWordCount();
 
-            do {
-                const VNumeric &input = argReader.getNumericRef(0);
-                if (!input.isNull()) {
-                    // sum += input (high precision NUMERIC)
-                    sum.accumulate(&input);
-                    // count only non-NULL rows (SQL AVG semantics)
-                    cnt++;
-                }
-            } while (argReader.next());
-        } catch (std::exception &e) {
-            vt_report_error(0,
-                "exact_avg: error in aggregate: [%s]", e.what());
-        }
+        windowRows = windowRowsParameter(srvInterface);
+        sumLen = sumWordsFor(sumPrecisionFor(p_in, rowCountDigitsFor(windowRows)));
+        addKernel = KernelPicker<AccumulateWords, MAX_NUMERIC_WORDS>::pick(inWords);
+
+        VTAllocator *allocator = srvInterface.allocator;
+        sum = static_cast<uint64 *>(allocator->alloc(
+            static_cast<size_t>(sumLen) * sizeof(uint64)));
+        divWords = static_cast<uint64 *>(allocator->alloc(
+            static_cast<size_t>(sumLen + 1) * sizeof(uint64)));
+        growWindow(srvInterface,
+                   windowRows < MIN_WINDOW_SLOTS ? windowRows : MIN_WINDOW_SLOTS);
     }
 
-    // Combine partial aggregates (sum, cnt, p_in, s_in) from different nodes/threads
-    virtual void combine(ServerInterface &srvInterface,
-                         IntermediateAggs &aggs,
-                         MultipleIntermediateAggs &aggsOther)
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  AnalyticPartitionReader &inputReader,
+                                  AnalyticPartitionWriter &outputWriter)
     {
         try {
-            VNumeric &mySum = aggs.getNumericRef(0);
-            vint &myCnt = aggs.getIntRef(1);
-            vint &myPIn = aggs.getIntRef(2);
-            vint &mySIn = aggs.getIntRef(3);
+            memset(sum, 0, static_cast<size_t>(sumLen) * sizeof(uint64));
+            vint frameRows = 0; // rows in the frame, NULL or not
+            vint rowCount = 0;  // non-NULL rows in the frame
+            vint slot = 0;      // ring position of the row leaving the frame
 
             do {
-                const VNumeric &otherSum = aggsOther.getNumericRef(0);
-                const vint &otherCnt = aggsOther.getIntRef(1);
-                const vint &otherPIn = aggsOther.getIntRef(2);
-                const vint &otherSIn = aggsOther.getIntRef(3);
-
-                mySum.accumulate(&otherSum);
-                myCnt += otherCnt;
-
-                // p_in and s_in are properties of the input column type, so
-                // they should match across all partials. For robustness, we
-                // take the maximum we see (they should all be equal in practice).
-                if (otherPIn > myPIn) {
-                    myPIn = otherPIn;
+                if (frameRows == windowRows) {
+                    addKernel(sum, sumLen, window + slot * inWords);
+                    rowCount -= windowNonNull[slot];
+                } else {
+                    // Until the frame is full, slot == frameRows.
+                    if (frameRows == windowSlots) {
+                        growWindow(srvInterface, windowSlots * 2 < windowRows
+                                                     ? windowSlots * 2
+                                                     : windowRows);
+                    }
+                    frameRows++;
                 }
-                if (otherSIn > mySIn) {
-                    mySIn = otherSIn;
+                uint64 *leaving = window + slot * inWords;
+
+                const VNumeric &input = inputReader.getNumericRef(0);
+                if (input.isNull()) {
+                    memset(leaving, 0, static_cast<size_t>(inWords) * sizeof(uint64));
+                    windowNonNull[slot] = 0;
+                } else {
+                    addKernel(sum, sumLen, input.words);
+                    memcpy(leaving, input.words,
+                           static_cast<size_t>(inWords) * sizeof(uint64));
+                    negateWords(leaving, inWords);
+                    windowNonNull[slot] = 1;
+                    rowCount++;
                 }
-            } while (aggsOther.next());
+                slot = slot + 1 == windowRows ? 0 : slot + 1;
+
+                // |sum| < window_rows * 10^p_in fits, as for exact_avg.
+                writeAverage("exact_moving_avg", sum, sumLen, sumScale, rowCount,
+                             outputWriter.getNumericRef(0), divWords);
+                outputWriter.next();
+            } while (inputReader.next());
         } catch (std::exception &e) {
             vt_report_error(0,
-                "exact_avg: error in combine: [%s]", e.what());
+                "exact_moving_avg: error in processPartition: [%s]", e.what());
         }
     }
 
-    // Finalize: avg = sum / cnt, with overflow diagnosis.
-    virtual void terminate(ServerInterface &srvInterface,
-                           BlockWriter &resWriter,
-                           IntermediateAggs &aggs)
-    {
-        try {
-            const VNumeric &sum = aggs.getNumericRef(0);
-            const vint &rowCount = aggs.getIntRef(1);
-            const vint &p_in_stored = aggs.getIntRef(2);
-            const vint &s_in_stored = aggs.getIntRef(3);
-
-            VNumeric &out = resWriter.getNumericRef(0);
-
-            // No non-NULL rows in this group → return NULL (like AVG)
-            if (rowCount == 0) {
-                out.setNull();
-                return;
-            }
+private:
+    // Scale of the SUM (the input's s_in).
+    int32 sumScale;
 
-            // Dummy usage of s_in_stored to avoid unused-variable warnings
-            // without affecting accuracy or logic.
-            if (s_in_stored < 0) {
-                vt_report_error(0,
-                    "exact_avg: internal error: invalid stored input scale %lld",
-                    static_cast<long long>(s_in_stored));
-            }
+    // Words in the SUM (p_in + digits10(window_rows - 1) digits) and in
+    // each input value.
+    int32 sumLen;
+    int32 inWords;
 
-            // Sanity check: we must know input precision to reason about overflow.
-            if (p_in_stored <= 0 || p_in_stored > MAX_NUMERIC_PRECISION) {
-                vt_report_error(0,
-                    "exact_avg: internal error: invalid stored input precision %lld",
-                    static_cast<long long>(p_in_stored));
-            }
+    // The window_rows parameter, and the ring buffer's current length.
+    vint windowRows;
+    vint windowSlots;
 
-            // Compute the number of decimal digits needed to represent rowCount.
-            // For example:
-            //   rowCount = 1        -> digitsN = 1
-            //   rowCount = 10       -> digitsN = 2
-            //   rowCount = 12345    -> digitsN = 5
-            if (rowCount < 0) {
-                vt_report_error(0,
-                    "exact_avg: internal error: negative row count %lld",
-                    static_cast<long long>(rowCount));
-            }
+    // AccumulateWords<N> for the input's word count N.
+    AccumulateWords<1>::Fn addKernel;
 
-            vint tmp = rowCount;
-            int32 digitsN = 0;
-            while (tmp > 0) {
-                tmp /= 10;
-                digitsN++;
-            }
-            if (digitsN == 0) {
-                // This can only happen if rowCount == 0, which is already handled,
-                // but we guard for completeness.
-                vt_report_error(0,
-                    "exact_avg: internal error: zero digit count for row count %lld",
-                    static_cast<long long>(rowCount));
-            }
+    // The window's SUM; the negated values of the last windowRows rows (0
+    // for NULLs) and whether each was non-NULL; the division scratch of the
+    // per-row writeAverage() in processPartition(). All allocated from
+    // srvInterface.allocator.
+    uint64 *sum;
+    uint64 *window;
+    unsigned char *windowNonNull;
+    uint64 *divWords;
 
-            // Worst-case total precision needed for the SUM:
-            //   p_needed = p_in + ceil(log10(rowCount)) = p_in + digitsN
-            int32 p_in = static_cast<int32>(p_in_stored);
-            int32 p_needed = p_in + digitsN;
-
-            // If the required precision exceeds Vertica's absolute cap (1024),
-            // no implementation can compute an exact SUM; we must fail loudly.
-            if (p_needed > MAX_NUMERIC_PRECISION) {
-                vt_report_error(
-                    0,
-                    "exact_avg: Cannot calculate the exact average for such huge numbers: "
-                    "required precision %d (input precision %d plus %d digits for row count %lld) "
-                    "exceeds Vertica NUMERIC maximum precision %d. "
-                    "Consider reducing the magnitude or number of rows.",
-                    p_needed,
-                    p_in,
-                    digitsN,
-                    static_cast<long long>(rowCount),
-                    MAX_NUMERIC_PRECISION);
-            }
-
-            // At this point, we know:
-            //   - p_needed <= 1024, so the exact sum CAN be represented.
-            //   - In getIntermediateTypes(), we chose p_sum = min(1024, p_in + 19).
-            //   - digitsN <= 19 for any 64-bit rowCount.
-            //   Therefore p_sum >= p_in + digitsN = p_needed, so the SUM we
-            //   accumulated is exactly representable in our intermediate type.
-
-            // Build a temporary NUMERIC representation of cnt using the same
-            // precision/scale as the intermediate SUM.
-            const VerticaType &sumType =
-                aggs.getTypeMetaData().getColumnType(0);
-
-            int32 wordCount = sumType.getNumericWordCount();
-            std::vector<uint64> buf(static_cast<size_t>(wordCount));
-
-            VNumeric cntNumeric(&buf[0],
-                                sumType.getNumericPrecision(),
-                                sumType.getNumericScale());
-            cntNumeric.setZero();
-
-            // Copy rowCount into cntNumeric as an exact integer.
-            cntNumeric.copy(rowCount);
-
-            // out = sum / cnt
-            out.div(&sum, &cntNumeric);
-        } catch (std::exception &e) {
-            vt_report_error(
-                0,
-                "exact_avg: error in terminate (overflow or divide): [%s]",
-                e.what());
+    // Reallocates the ring buffer with room for slots rows, keeping the
+    // first windowSlots (the frame, while it is not yet full).
+    void growWindow(ServerInterface &srvInterface, vint slots)
+    {
+        const size_t valueBytes = static_cast<size_t>(inWords) * sizeof(uint64);
+        uint64 *grown = static_cast<uint64 *>(srvInterface.allocator->alloc(
+            static_cast<size_t>(slots) * valueBytes));
+        unsigned char *grownNonNull = static_cast<unsigned char *>(
+            srvInterface.allocator->alloc(static_cast<size_t>(slots)));
+        if (windowSlots > 0) {
+            memcpy(grown, window, static_cast<size_t>(windowSlots) * valueBytes);
+            memcpy(grownNonNull, windowNonNull, static_cast<size_t>(windowSlots));
         }
+        window = grown;
+        windowNonNull = grownNonNull;
+        windowSlots = slots;
     }
 };
 
-
-/**
- * Factory: validates arguments, chooses return type, and defines
- * intermediate (sum, cnt, p_in, s_in) types.
- */
-class ExactAvgFactory : public AggregateFunctionFactory
+class ExactMovingAvgFactory : public AnalyticFunctionFactory
 {
 public:
     // One NUMERIC argument, numeric return
@@ -281,123 +4477,391 @@ public:
                               ColumnTypes &argTypes,
                               ColumnTypes &returnType)
     {
-        argTypes.addNumeric();   // input must be NUMERIC/DECIMAL
-        returnType.addNumeric(); // actual p,s decided in getReturnType()
+        argTypes.addNumeric();
+        returnType.addNumeric();
     }
 
-    // Decide output NUMERIC(p_out, s_out) based on input NUMERIC(p_in, s_in)
+    // The same NUMERIC(p_out, s_out) as exact_avg
     virtual void getReturnType(ServerInterface &srvInterface,
                                const SizedColumnTypes &inputTypes,
                                SizedColumnTypes &outputTypes)
     {
         if (inputTypes.getColumnCount() != 1) {
             vt_report_error(0,
-                "exact_avg expects exactly one argument");
+                "exact_moving_avg expects exactly one argument");
         }
+        addAverageType(inputTypes.getColumnType(0), "exact_moving_avg",
+                       outputTypes);
+    }
 
-        const VerticaType &inType = inputTypes.getColumnType(0);
+    // Required: window_rows, the frame length in rows (the current row and
+    // window_rows - 1 preceding).
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes)
+    {
+        parameterTypes.addInt("window_rows");
+    }
 
-        if (!inType.isNumeric()) {
-            vt_report_error(0,
-                "exact_avg expects a NUMERIC/DECIMAL input type");
-        }
+    virtual AnalyticFunction *createAnalyticFunction(
+        ServerInterface &srvInterface)
+    {
+        return vt_createFuncObject<ExactMovingAvg>(srvInterface.allocator);
+    }
+};
+
+RegisterFactory(ExactMovingAvgFactory);
+
+/*
+ * Analytic exact_avg over a cumulative frame (ExactRunningAvgFactory):
+ *
+ *   exact_running_avg(a) OVER (PARTITION BY ... ORDER BY t)
+ *
+ * is AVG(a) OVER (... ROWS BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW),
+ * exact, in one pass over the partition: each row adds its value to the
+ * running SUM and divides once. A NULL row changes neither the SUM nor the
+ * count, so it repeats the previous row's average without dividing again.
+ * The SUM is sized like exact_avg's, for max_rows rows per partition.
+ */
+class ExactRunningAvg : public AnalyticFunction
+{
+public:
+    ExactRunningAvg()
+        : sumScale(0), sumLen(0), outWords(0), maxRows(0), addKernel(0),
+          sum(0), lastAverage(0), divWords(0)
+    {
+    }
+
+    virtual void setup(ServerInterface &srvInterface,
+                       const SizedColumnTypes &argTypes)
+    {
+        const VerticaType &inType = argTypes.getColumnType(0);
+        int32 p_in;
+        inputPrecisionScale(inType, "exact_running_avg", p_in, sumScale);
 
-        int32 p_in = inType.getNumericPrecision();
-        int32 s_in = inType.getNumericScale();
+        maxRows = maxRowsParameter(srvInterface, "exact_running_avg");
+        sumLen = sumWordsFor(sumPrecisionFor(p_in, rowCountDigitsFor(maxRows)));
+        addKernel = KernelPicker<AccumulateWords, MAX_NUMERIC_WORDS>::pick(
+            inType.getNumericWordCount());
 
-        if (p_in <= 0 || p_in > MAX_NUMERIC_PRECISION) {
+        SizedColumnTypes outTypes;
+        addAverageType(inType, "exact_running_avg", outTypes);
+        outWords = outTypes.getColumnType(0).getNumericWordCount();
+
+        VTAllocator *allocator = srvInterface.allocator;
+        sum = static_cast<uint64 *>(allocator->alloc(
+            static_cast<size_t>(sumLen) * sizeof(uint64)));
+        lastAverage = static_cast<uint64 *>(allocator->alloc(
+            static_cast<size_t>(outWords) * sizeof(uint64)));
+        divWords = static_cast<uint64 *>(allocator->alloc(
+            static_cast<size_t>(sumLen + 1) * sizeof(uint64)));
+    }
+
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  AnalyticPartitionReader &inputReader,
+                                  AnalyticPartitionWriter &outputWriter)
+    {
+        try {
+            const size_t outBytes = static_cast<size_t>(outWords) * sizeof(uint64);
+            memset(sum, 0, static_cast<size_t>(sumLen) * sizeof(uint64));
+            vint rowCount = 0;
+
+            do {
+                const VNumeric &input = inputReader.getNumericRef(0);
+                VNumeric &out = outputWriter.getNumericRef(0);
+                if (!input.isNull()) {
+                    addKernel(sum, sumLen, input.words);
+                    if (++rowCount > maxRows) {
+                        vt_report_error(0,
+                            "exact_running_avg: a partition has more than "
+                            "max_rows = %lld non-NULL rows; raise max_rows or "
+                            "omit it",
+                            static_cast<long long>(maxRows));
+                    }
+                    writeAverage("exact_running_avg", sum, sumLen, sumScale,
+                                 rowCount, out, divWords);
+                    memcpy(lastAverage, out.words, outBytes);
+                } else if (rowCount == 0) {
+                    out.setNull();
+                } else {
+                    memcpy(out.words, lastAverage, outBytes);
+                }
+                outputWriter.next();
+            } while (inputReader.next());
+        } catch (std::exception &e) {
             vt_report_error(0,
-                "exact_avg: invalid input NUMERIC precision %d", p_in);
+                "exact_running_avg: error in processPartition: [%s]", e.what());
         }
+    }
 
-        // Grow precision/scale a bit, but keep within Vertica limits.
-        //   p_out = min(1024, p_in + 5)
-        //   s_out = min(p_out, s_in + 5)
-        int32 p_out = p_in + 5;
-        if (p_out > MAX_NUMERIC_PRECISION) {
-            p_out = MAX_NUMERIC_PRECISION;
-        }
+private:
+    // Scale of the SUM (the input's s_in).
+    int32 sumScale;
 
-        int32 s_out = s_in + 5;
-        if (s_out > p_out) {
-            s_out = p_out;   // scale cannot exceed precision
-        }
-        if (s_out < 0) {
-            s_out = 0;
-        }
+    // Words in the SUM (p_in + digits10(max_rows - 1) digits) and in the
+    // NUMERIC(p_out, s_out) result.
+    int32 sumLen;
+    int32 outWords;
 
-        outputTypes.addNumeric(p_out, s_out, "exact_avg");
+    // The max_rows parameter; the SUM only has room for this many rows.
+    vint maxRows;
+
+    // AccumulateWords<N> for the input's word count N.
+    AccumulateWords<1>::Fn addKernel;
+
+    // The running SUM, the last non-NULL row's average, and the division
+    // scratch of the per-row writeAverage() in processPartition(), allocated
+    // once in setup() and reused by every partition.
+    uint64 *sum;
+    uint64 *lastAverage;
+    uint64 *divWords;
+};
+
+class ExactRunningAvgFactory : public AnalyticFunctionFactory
+{
+public:
+    // One NUMERIC argument, numeric return
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addNumeric();
+        returnType.addNumeric();
     }
 
-    // Decide intermediate (sum, cnt, p_in, s_in) types
-    virtual void getIntermediateTypes(ServerInterface &srvInterface,
-                                      const SizedColumnTypes &inputTypes,
-                                      SizedColumnTypes &intermediateTypes)
+    // The same NUMERIC(p_out, s_out) as exact_avg
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
     {
         if (inputTypes.getColumnCount() != 1) {
             vt_report_error(0,
-                "exact_avg expects exactly one argument");
+                "exact_running_avg expects exactly one argument");
         }
+        addAverageType(inputTypes.getColumnType(0), "exact_running_avg",
+                       outputTypes);
+    }
 
-        const VerticaType &inType = inputTypes.getColumnType(0);
+    // Optional: max_rows, an upper bound on the non-NULL rows per partition.
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes)
+    {
+        parameterTypes.addInt("max_rows");
+    }
 
-        if (!inType.isNumeric()) {
-            vt_report_error(0,
-                "exact_avg expects a NUMERIC/DECIMAL input type");
+    virtual AnalyticFunction *createAnalyticFunction(
+        ServerInterface &srvInterface)
+    {
+        return vt_createFuncObject<ExactRunningAvg>(srvInterface.allocator);
+    }
+};
+
+RegisterFactory(ExactRunningAvgFactory);
+
+/*
+ * Multi-column exact_avg in one pass (ExactAvgMultiFactory):
+ *
+ *   SELECT g, exact_avg_multi(a, b, c) OVER (PARTITION BY g) FROM t
+ *
+ * is exact_avg(a), exact_avg(b), exact_avg(c) ... GROUP BY g, but reads the
+ * partition's rows once instead of once per aggregate. Every column keeps
+ * its own carry-save accumulator; the per-column state is laid out as
+ * parallel arrays (word counts, lane offsets, NULL-free row counts, negative
+ * counts), and the lanes of all columns share one contiguous buffer, so a
+ * row touches a single run of memory however many columns it has.
+ *
+ * A non-NULL value is added as N independent 128-bit lane adds (see
+ * flushLanes()); no carries propagate per row, so a plain loop over the
+ * column's word count serves every width without a kernel per column. The
+ * lanes are flushed into each column's SUM, and divided, once per partition,
+ * which then emits one row of NUMERIC(p_out, s_out) averages, NULL for a
+ * column with no non-NULL rows.
+ */
+class ExactAvgMulti : public TransformFunction
+{
+public:
+    ExactAvgMulti()
+        : columns(0), maxRows(0), sumCapacity(0), laneCount(0), inWords(0),
+          laneAt(0), sumLen(0), sumScale(0), rowCounts(0), negatives(0),
+          lanes(0), sum(0), divWords(0)
+    {
+    }
+
+    virtual void setup(ServerInterface &srvInterface,
+                       const SizedColumnTypes &argTypes)
+    {
+        columns = static_cast<int32>(argTypes.getColumnCount());
+        maxRows = maxRowsParameter(srvInterface, "exact_avg_multi");
+        const int32 rowDigits = rowCountDigitsFor(maxRows);
+
+        VTAllocator *allocator = srvInterface.allocator;
+        const size_t n = static_cast<size_t>(columns);
+        inWords = static_cast<int32 *>(allocator->alloc(n * sizeof(int32)));
+        laneAt = static_cast<int32 *>(allocator->alloc(n * sizeof(int32)));
+        sumLen = static_cast<int32 *>(allocator->alloc(n * sizeof(int32)));
+        sumScale = static_cast<int32 *>(allocator->alloc(n * sizeof(int32)));
+        rowCounts = static_cast<vint *>(allocator->alloc(n * sizeof(vint)));
+        negatives = static_cast<uint64 *>(allocator->alloc(n * sizeof(uint64)));
+
+        laneCount = 0;
+        for (int32 c = 0; c < columns; ++c) {
+            const VerticaType &inType = argTypes.getColumnType(c);
+            int32 p_in;
+            inputPrecisionScale(inType, "exact_avg_multi", p_in, sumScale[c]);
+            inWords[c] = inType.getNumericWordCount();
+            laneAt[c] = laneCount;
+            laneCount += inWords[c];
+            sumLen[c] = sumWordsFor(sumPrecisionFor(p_in, rowDigits));
+            if (sumLen[c] > sumCapacity) {
+                sumCapacity = sumLen[c];
+            }
         }
 
-        int32 p_in = inType.getNumericPrecision();
-        int32 s_in = inType.getNumericScale();
+        lanes = static_cast<unsigned __int128 *>(allocator->alloc(
+            static_cast<size_t>(laneCount) * sizeof(unsigned __int128)));
+        memset(lanes, 0,
+               static_cast<size_t>(laneCount) * sizeof(unsigned __int128));
+        sum = static_cast<uint64 *>(allocator->alloc(
+            static_cast<size_t>(sumCapacity) * sizeof(uint64)));
+        divWords = static_cast<uint64 *>(allocator->alloc(
+            static_cast<size_t>(sumCapacity + 1) * sizeof(uint64)));
+    }
+
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  PartitionReader &inputReader,
+                                  PartitionWriter &outputWriter)
+    {
+        try {
+            const size_t n = static_cast<size_t>(columns);
+            memset(rowCounts, 0, n * sizeof(vint));
+            memset(negatives, 0, n * sizeof(uint64));
+
+            do {
+                for (int32 c = 0; c < columns; ++c) {
+                    const VNumeric &input = inputReader.getNumericRef(c);
+                    if (input.isNull()) {
+                        continue;
+                    }
+                    unsigned __int128 *lane = lanes + laneAt[c];
+                    const int32 words = inWords[c];
+                    for (int32 i = 0; i < words; ++i) {
+                        lane[i] += input.words[i];
+                    }
+                    negatives[c] += input.words[0] >> 63;
+                    rowCounts[c]++;
+                }
+            } while (inputReader.next());
 
-        if (p_in <= 0 || p_in > MAX_NUMERIC_PRECISION) {
+            for (int32 c = 0; c < columns; ++c) {
+                if (rowCounts[c] > maxRows) {
+                    vt_report_error(0,
+                        "exact_avg_multi: a partition has more than "
+                        "max_rows = %lld non-NULL rows in argument %d; raise "
+                        "max_rows or omit it",
+                        static_cast<long long>(maxRows), c + 1);
+                }
+                memset(sum, 0, static_cast<size_t>(sumLen[c]) * sizeof(uint64));
+                flushLanes(sum, sumLen[c], lanes + laneAt[c], inWords[c],
+                           negatives[c]);
+                writeAverage("exact_avg_multi", sum, sumLen[c], sumScale[c],
+                             rowCounts[c], outputWriter.getNumericRef(c),
+                             divWords);
+            }
+            outputWriter.next();
+        } catch (std::exception &e) {
+            // The columns not yet flushed keep this partition's lanes; clear
+            // them so that an instance that sees another partition starts
+            // from zero.
+            memset(lanes, 0,
+                   static_cast<size_t>(laneCount) * sizeof(unsigned __int128));
             vt_report_error(0,
-                "exact_avg: invalid input NUMERIC precision %d", p_in);
+                "exact_avg_multi: error in processPartition: [%s]", e.what());
         }
+    }
 
-        /*
-         * Performance vs safety for the SUM precision:
-         *
-         *   - Worst-case we need: p_needed = p_in + ceil(log10(N))
-         *   - For a 64-bit row count, N <= 9,223,372,036,854,775,807, so
-         *         ceil(log10(N)) <= 19.
-         *   - So p_in + 19 digits are enough to represent the SUM exactly
-         *     for any possible rowCount within Vertica.
-         *
-         * We choose:
-         *   p_sum = min(1024, p_in + 19)
-         *
-         * This is:
-         *   - Always large enough when an exact sum is representable
-         *     (p_needed <= 1024).
-         *   - Cheaper than always using p_sum = 1024 for small/moderate p_in.
-         */
-        int32 extra_digits_for_rows = 19;
-        int32 p_sum = p_in + extra_digits_for_rows;
-        if (p_sum > MAX_NUMERIC_PRECISION) {
-            p_sum = MAX_NUMERIC_PRECISION;
-        }
+private:
+    // Number of arguments, and the max_rows parameter every column's SUM is
+    // sized for.
+    int32 columns;
+    vint maxRows;
 
-        // Keep the same scale for the sum as the input, clamped to [0, p_sum].
-        int32 s_sum = s_in;
-        if (s_sum > p_sum) {
-            s_sum = p_sum;
+    // Words in the widest column's SUM, and lanes of all columns.
+    int32 sumCapacity;
+    int32 laneCount;
+
+    // Per column c: input words, offset of its lanes in lanes[], SUM words,
+    // SUM scale (the input's s_in), non-NULL rows and negative inputs in the
+    // current partition.
+    int32 *inWords;
+    int32 *laneAt;
+    int32 *sumLen;
+    int32 *sumScale;
+    vint *rowCounts;
+    uint64 *negatives;
+
+    // Every column's carry-save lanes, back to back; flushLanes() clears a
+    // column's lanes as it folds them, and a failed partition clears them
+    // all, so they are zero between partitions.
+    unsigned __int128 *lanes;
+
+    // One column's SUM and its division scratch, reused column by column.
+    uint64 *sum;
+    uint64 *divWords;
+};
+
+class ExactAvgMultiFactory : public TransformFunctionFactory
+{
+public:
+    // Any number of NUMERIC arguments, as many numeric outputs
+    virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType)
+    {
+        argTypes.addAny();
+        returnType.addAny();
+    }
+
+    // One exact_avg NUMERIC(p_out, s_out) per argument, named after the
+    // argument's column (or exact_avg_<i> for an expression).
+    virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes)
+    {
+        const size_t count = inputTypes.getColumnCount();
+        if (count == 0) {
+            vt_report_error(0,
+                "exact_avg_multi expects at least one NUMERIC argument");
         }
-        if (s_sum < 0) {
-            s_sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const VerticaType &inType = inputTypes.getColumnType(i);
+            if (!inType.isNumeric()) {
+                vt_report_error(0,
+                    "exact_avg_multi: argument %d is not a NUMERIC/DECIMAL",
+                    static_cast<int>(i + 1));
+            }
+            std::string name = inputTypes.getColumnName(i);
+            if (name.empty()) {
+                std::ostringstream fallback;
+                fallback << "exact_avg_" << (i + 1);
+                name = fallback.str();
+            }
+            addAverageType(inType, "exact_avg_multi", outputTypes,
+                           name.c_str());
         }
+    }
 
-        intermediateTypes.addNumeric(p_sum, s_sum, "sum"); // index 0
-        intermediateTypes.addInt("cnt");                   // index 1
-        intermediateTypes.addInt("p_in");                  // index 2
-        intermediateTypes.addInt("s_in");                  // index 3
+    // Optional: max_rows, an upper bound on the non-NULL rows per column and
+    // partition.
+    virtual void getParameterType(ServerInterface &srvInterface,
+                                  SizedColumnTypes &parameterTypes)
+    {
+        parameterTypes.addInt("max_rows");
     }
 
-    virtual AggregateFunction *createAggregateFunction(
+    virtual TransformFunction *createTransformFunction(
         ServerInterface &srvInterface)
     {
-        return vt_createFuncObject<ExactAvg>(srvInterface.allocator);
+        return vt_createFuncObject<ExactAvgMulti>(srvInterface.allocator);
     }
 };
 
-RegisterFactory(ExactAvgFactory);
-
+RegisterFactory(ExactAvgMultiFactory);